@@ -1,142 +1,171 @@
 #include "Book.h"
-#include <fstream>
 #include <sstream>
 #include <vector>
 #include <jsoncpp/json/json.h>
 #include <algorithm>
 
-// CSV file path
-const std::string BookController::CSV_FILE = "books.csv";
-
-// Utility function to escape CSV strings
-std::string Book::escapeCSV(const std::string& str)
+// Catalog store plugin, configured in config.json
+BookStore& BookController::store()
 {
-    std::string escapedStr = str;
-    if (str.find(',') != std::string::npos || str.find('"') != std::string::npos)
-    {
-        escapedStr = '"' + str + '"';
-    }
-    return escapedStr;
+    static BookStore* store = drogon::app().getPlugin<BookStore>();
+    return *store;
 }
 
-// Convert Book object to CSV format
-std::string Book::toCSV() const
+// Worker pools that keep storage work off the event loops
+StoragePool& BookController::storagePool()
 {
-    std::ostringstream oss;
-    oss << escapeCSV(bookID) << ','
-        << escapeCSV(title) << ','
-        << escapeCSV(authors) << ','
-        << escapeCSV(avgRating) << ','
-        << escapeCSV(isbn) << ','
-        << escapeCSV(isbn13) << ','
-        << escapeCSV(languageCode) << ','
-        << escapeCSV(numPages) << ','
-        << escapeCSV(ratingsCount) << ','
-        << escapeCSV(textReviewsCount) << ','
-        << escapeCSV(publicationDate) << ','
-        << escapeCSV(publisher);
-    return oss.str();
+    static StoragePool* pool = drogon::app().getPlugin<StoragePool>();
+    return *pool;
 }
 
-// Create Book object from CSV line
-Book Book::fromCSV(const std::string& line)
+// In-flight reads shared between identical concurrent requests
+RequestCoalescer& BookController::coalescer()
 {
-    std::istringstream iss(line);
-    std::string token;
-    std::vector<std::string> tokens;
+    static RequestCoalescer coalescer;
+    return coalescer;
+}
 
-    while (std::getline(iss, token, ','))
+// Run compute once for all concurrent requests with the same key: the first
+// request computes the response and the others share a copy of it
+drogon::Task<drogon::HttpResponsePtr> BookController::coalesced(BookMetrics::Route route, std::string key,
+                                                               std::function<drogon::Task<drogon::HttpResponsePtr>()> compute)
+{
+    bool leader;
+    auto flight = coalescer().join(key, leader);
+    if (!leader)
     {
-        // Remove leading and trailing spaces from each token
-        token.erase(0, token.find_first_not_of(' '));
-        token.erase(token.find_last_not_of(' ') + 1);
-        tokens.push_back(token);
+        BookMetrics::addCoalesced(route);
+        co_return co_await RequestCoalescer::wait(flight);
     }
 
-    Book book;
-    if (tokens.size() >= 12)
-    {
-        book.bookID = tokens[0];
-        book.title = tokens[1];
-        book.authors = tokens[2];
-        book.avgRating = tokens[3];
-        book.isbn = tokens[4];
-        book.isbn13 = tokens[5];
-        book.languageCode = tokens[6];
-        book.numPages = tokens[7];
-        book.ratingsCount = tokens[8];
-        book.textReviewsCount = tokens[9];
-        book.publicationDate = tokens[10];
-        book.publisher = tokens[11];
+    drogon::HttpResponsePtr resp;
+    try
+    {
+        resp = co_await compute();
     }
-
-    return book;
+    catch (...)
+    {
+        coalescer().finish(key, flight, nullptr, std::current_exception());
+        throw;
+    }
+    coalescer().finish(key, flight, resp);
+    co_return resp;
 }
 
-// Read books from CSV file
-std::vector<Book> BookController::readBooksFromCSV(int limit, int offset)
+// Response for requests rejected because a storage pool queue is full
+drogon::HttpResponsePtr BookController::overloadedResponse(BookMetrics::Route route)
 {
-    std::ifstream file(CSV_FILE);
-    std::vector<Book> books;
-    std::string line;
-    int count = 0;
-
-    // Skip the header line
-    std::getline(file, line);
+    BookMetrics::addRejected(route);
+    auto resp = drogon::HttpResponse::newHttpResponse();
+    resp->setStatusCode(drogon::k503ServiceUnavailable);
+    resp->addHeader("Retry-After", std::to_string(storagePool().retryAfter()));
+    resp->setBody("Server is overloaded, please retry later");
+    return resp;
+}
 
-    while (std::getline(file, line))
+// Read the limit and offset query parameters used by paginated listings,
+// keeping the caller's defaults when they are absent; limit is capped at MAX_PAGE_SIZE
+void BookController::pageParameters(const drogon::HttpRequestPtr& req, int& limit, int& offset)
+{
+    try
     {
-        if (count >= offset && (limit == -1 || count < offset + limit))
+        if (!req->getParameter("limit").empty())
         {
-            books.push_back(Book::fromCSV(line));
+            limit = std::stoi(req->getParameter("limit"));
+        }
+        if (!req->getParameter("offset").empty())
+        {
+            offset = std::stoi(req->getParameter("offset"));
         }
-        count++;
     }
-
-    return books;
+    catch (const std::logic_error&)
+    {
+        throw std::invalid_argument("limit and offset must be integers");
+    }
+    if (limit < 0 || offset < 0)
+    {
+        throw std::invalid_argument("limit and offset must not be negative");
+    }
+    limit = std::min(limit, MAX_PAGE_SIZE);
 }
 
-// Write books to CSV file
-void BookController::writeBooksToCSV(const std::vector<Book>& books)
+// JSON array of books for the index-backed listings
+drogon::HttpResponsePtr BookController::booksResponse(BookMetrics::Route route, const std::vector<BookPtr>& books)
 {
-    std::ofstream file(CSV_FILE);
-
-    if (!file.is_open())
+    BookMetrics::addRows(route, books.size(), books.size());
+    BookMetrics::Timer serializeTimer(route, BookMetrics::Serialize);
+    Json::Value jsonBooks(Json::arrayValue);
+    for (const auto& book : books)
     {
-        throw std::runtime_error("Unable to open CSV file for writing");
+        jsonBooks.append(book->toJson());
     }
+    return drogon::HttpResponse::newHttpJsonResponse(jsonBooks);
+}
 
-    // Write header
-    file << "bookID,title,authors,avgRating,isbn,isbn13,languageCode,numPages,ratingsCount,textReviewsCount,publicationDate,publisher\n";
-
-    // Write book data
-    for (const auto& book : books)
+// JSON array of names with their book counts
+drogon::HttpResponsePtr BookController::namesResponse(BookMetrics::Route route, const std::vector<NameCount>& names)
+{
+    BookMetrics::addRows(route, names.size(), names.size());
+    BookMetrics::Timer serializeTimer(route, BookMetrics::Serialize);
+    Json::Value jsonNames(Json::arrayValue);
+    for (const auto& entry : names)
     {
-        file << book.toCSV() << "\n";
+        Json::Value jsonName;
+        jsonName["name"] = entry.name;
+        jsonName["bookCount"] = static_cast<Json::UInt64>(entry.bookCount);
+        jsonNames.append(jsonName);
     }
-
-    file.close();
+    return drogon::HttpResponse::newHttpJsonResponse(jsonNames);
 }
 
-// Find book by title
-Book BookController::findBookByTitle(const std::string& title)
+// Read a string field from a JSON request body. Records are stored one per
+// line, so control characters such as line breaks are refused.
+std::string BookController::stringField(const Json::Value& json, const char* name)
 {
-    std::ifstream file(CSV_FILE);
-    std::string line;
-
-    // Skip the header line
-    std::getline(file, line);
-
-    while (std::getline(file, line))
+    std::string value = json.get(name, "").asString();
+    for (char c : value)
     {
-        Book book = Book::fromCSV(line);
-        if (book.title == title)
+        unsigned char byte = static_cast<unsigned char>(c);
+        if (byte < 0x20 || byte == 0x7f)
         {
-            return book;
+            throw std::invalid_argument(std::string("Field '") + name + "' must not contain control characters");
         }
     }
+    return value;
+}
+
+// Create Book object from a JSON request body, without a bookID
+Book BookController::bookFromJson(const Json::Value& json)
+{
+    Book book;
+    book.title = stringField(json, "title");
+    book.authors = stringField(json, "authors");
+    book.avgRating = stringField(json, "avgRating");
+    book.isbn = stringField(json, "isbn");
+    book.isbn13 = stringField(json, "isbn13");
+    book.languageCode = stringField(json, "languageCode");
+    book.numPages = stringField(json, "numPages");
+    book.ratingsCount = stringField(json, "ratingsCount");
+    book.textReviewsCount = stringField(json, "textReviewsCount");
+    book.publicationDate = stringField(json, "publicationDate");
+    book.publisher = stringField(json, "publisher");
+    return book;
+}
 
-    throw std::runtime_error("Book not found");
+// Update the book details with the fields present in a JSON request body
+void BookController::applyJson(Book& book, const Json::Value& json)
+{
+    if (json.isMember("title")) book.title = stringField(json, "title");
+    if (json.isMember("authors")) book.authors = stringField(json, "authors");
+    if (json.isMember("avgRating")) book.avgRating = stringField(json, "avgRating");
+    if (json.isMember("isbn")) book.isbn = stringField(json, "isbn");
+    if (json.isMember("isbn13")) book.isbn13 = stringField(json, "isbn13");
+    if (json.isMember("languageCode")) book.languageCode = stringField(json, "languageCode");
+    if (json.isMember("numPages")) book.numPages = stringField(json, "numPages");
+    if (json.isMember("ratingsCount")) book.ratingsCount = stringField(json, "ratingsCount");
+    if (json.isMember("textReviewsCount")) book.textReviewsCount = stringField(json, "textReviewsCount");
+    if (json.isMember("publicationDate")) book.publicationDate = stringField(json, "publicationDate");
+    if (json.isMember("publisher")) book.publisher = stringField(json, "publisher");
 }
 
 // Utility function to parse date strings
@@ -176,8 +205,9 @@ bool BookController::dateInRange(const std::string& date, const std::string& sta
 }
 
 // Handler for the getBooks endpoint
-void BookController::getBooks(const drogon::HttpRequestPtr& req, std::function<void(const drogon::HttpResponsePtr&)>&& callback)
+drogon::Task<drogon::HttpResponsePtr> BookController::getBooks(drogon::HttpRequestPtr req)
 {
+    BookMetrics::Timer totalTimer(BookMetrics::GetBooks, BookMetrics::Total);
     auto queryParams = req->getParameters();
     int limit = -1;
     int offset = 0;
@@ -246,91 +276,105 @@ void BookController::getBooks(const drogon::HttpRequestPtr& req, std::function<v
     }
 
 
-    try
-    {
-        auto books = readBooksFromCSV(limit, offset);
-        Json::Value jsonBooks(Json::arrayValue);
-
-        for (const auto& book : books)
+    // Identical requests against the same catalog version share one computation
+    std::string key = RequestCoalescer::key({"getBooks", std::to_string(store().version()), std::to_string(limit),
+                                              std::to_string(offset), bookID, title, authors, avgRating, isbn, isbn13,
+                                              languageCode, numPages, publisher, publicationDate});
+    co_return co_await coalesced(BookMetrics::GetBooks, key, [&]() -> drogon::Task<drogon::HttpResponsePtr> {
+        try
         {
-            bool matches = true;
-
-            if (!bookID.empty() && book.bookID != bookID)
-            {
-                matches = false;
-            }
-            if (!title.empty() && book.title != title)
-            {
-                matches = false;
-            }
-            if (!authors.empty() && book.authors != authors)
-            {
-                matches = false;
-            }
-            if (!avgRating.empty() && book.avgRating != avgRating)
-            {
-                matches = false;
-            }
-            if (!isbn.empty() && book.isbn != isbn)
-            {
-                matches = false;
-            }
-            if (!isbn13.empty() && book.isbn13 != isbn13)
-            {
-                matches = false;
-            }
-            if (!languageCode.empty() && book.languageCode != languageCode)
-            {
-                matches = false;
-            }
-            if (!numPages.empty() && book.numPages != numPages)
-            {
-                matches = false;
-            }
-            if (!publisher.empty() && book.publisher != publisher)
-            {
-                matches = false;
-            }
-            if (!publicationDate.empty() && book.publicationDate != publicationDate)
-            {
-                matches = false;
-            }
-
-
-            if (matches)
-            {
-                Json::Value jsonBook;
-                jsonBook["bookID"] = book.bookID;
-                jsonBook["title"] = book.title;
-                jsonBook["authors"] = book.authors;
-                jsonBook["avgRating"] = book.avgRating;
-                jsonBook["isbn"] = book.isbn;
-                jsonBook["isbn13"] = book.isbn13;
-                jsonBook["languageCode"] = book.languageCode;
-                jsonBook["numPages"] = book.numPages;
-                jsonBook["ratingsCount"] = book.ratingsCount;
-                jsonBook["textReviewsCount"] = book.textReviewsCount;
-                jsonBook["publicationDate"] = book.publicationDate;
-                jsonBook["publisher"] = book.publisher;
-                jsonBooks.append(jsonBook);
-            }
+            co_return co_await storagePool().compute().run([&]() -> drogon::HttpResponsePtr {
+                BookMetrics::Timer loadTimer(BookMetrics::GetBooks, BookMetrics::Load);
+                auto books = store().list(limit, offset);
+                loadTimer.stop();
+
+                BookMetrics::Timer filterTimer(BookMetrics::GetBooks, BookMetrics::Filter);
+                std::vector<const Book*> matchedBooks;
+
+                for (const auto& book : books)
+                {
+                    bool matches = true;
+
+                    if (!bookID.empty() && book->bookID != bookID)
+                    {
+                        matches = false;
+                    }
+                    if (!title.empty() && book->title != title)
+                    {
+                        matches = false;
+                    }
+                    if (!authors.empty() && book->authors != authors)
+                    {
+                        matches = false;
+                    }
+                    if (!avgRating.empty() && book->avgRating != avgRating)
+                    {
+                        matches = false;
+                    }
+                    if (!isbn.empty() && book->isbn != isbn)
+                    {
+                        matches = false;
+                    }
+                    if (!isbn13.empty() && book->isbn13 != isbn13)
+                    {
+                        matches = false;
+                    }
+                    if (!languageCode.empty() && book->languageCode != languageCode)
+                    {
+                        matches = false;
+                    }
+                    if (!numPages.empty() && book->numPages != numPages)
+                    {
+                        matches = false;
+                    }
+                    if (!publisher.empty() && book->publisher != publisher)
+                    {
+                        matches = false;
+                    }
+                    if (!publicationDate.empty() && book->publicationDate != publicationDate)
+                    {
+                        matches = false;
+                    }
+
+
+                    if (matches)
+                    {
+                        matchedBooks.push_back(book.get());
+                    }
+                }
+                filterTimer.stop();
+                BookMetrics::addRows(BookMetrics::GetBooks, books.size(), matchedBooks.size());
+
+                BookMetrics::Timer serializeTimer(BookMetrics::GetBooks, BookMetrics::Serialize);
+                Json::Value jsonBooks(Json::arrayValue);
+                for (const Book* book : matchedBooks)
+                {
+                    jsonBooks.append(book->toJson());
+                }
+
+                auto resp = drogon::HttpResponse::newHttpJsonResponse(jsonBooks);
+                serializeTimer.stop();
+                return resp;
+            });
         }
-
-        auto resp = drogon::HttpResponse::newHttpJsonResponse(jsonBooks);
-        callback(resp);
-    }
-    catch (const std::exception& e)
-    {
-        auto resp = drogon::HttpResponse::newHttpResponse();
-        resp->setStatusCode(drogon::k500InternalServerError);
-        resp->setBody(e.what());
-        callback(resp);
-    }
+        catch (const PoolOverloaded&)
+        {
+            co_return overloadedResponse(BookMetrics::GetBooks);
+        }
+        catch (const std::exception& e)
+        {
+            auto resp = drogon::HttpResponse::newHttpResponse();
+            resp->setStatusCode(drogon::k500InternalServerError);
+            resp->setBody(e.what());
+            co_return resp;
+        }
+    });
 }
 
 // Handler for the filterBooks endpoint
-void BookController::filterBooks(const drogon::HttpRequestPtr& req, std::function<void(const drogon::HttpResponsePtr&)>&& callback)
+drogon::Task<drogon::HttpResponsePtr> BookController::filterBooks(drogon::HttpRequestPtr req)
 {
+    BookMetrics::Timer totalTimer(BookMetrics::FilterBooks, BookMetrics::Total);
     auto queryParams = req->getParameters();
     std::string startDate;
     std::string endDate;
@@ -351,147 +395,254 @@ void BookController::filterBooks(const drogon::HttpRequestPtr& req, std::functio
         sortOrder = queryParams.at("sortOrder");
     }
 
-    try
-    {
-        auto books = readBooksFromCSV(); // Read all books
-        Json::Value jsonBooks(Json::arrayValue);
-
-        for (const auto& book : books)
+    // Identical requests against the same catalog version share one computation
+    std::string key = RequestCoalescer::key(
+        {"filterBooks", std::to_string(store().version()), startDate, endDate, sortOrder});
+    co_return co_await coalesced(BookMetrics::FilterBooks, key, [&]() -> drogon::Task<drogon::HttpResponsePtr> {
+        try
+        {
+            co_return co_await storagePool().compute().run([&]() -> drogon::HttpResponsePtr {
+                BookMetrics::Timer loadTimer(BookMetrics::FilterBooks, BookMetrics::Load);
+                auto books = store().list(); // Read all books
+                loadTimer.stop();
+
+                BookMetrics::Timer filterTimer(BookMetrics::FilterBooks, BookMetrics::Filter);
+                std::vector<const Book*> matchedBooks;
+
+                for (const auto& book : books)
+                {
+                    bool matches = true;
+
+                    if (!startDate.empty() && !endDate.empty() && !dateInRange(book->publicationDate, startDate, endDate))
+                    {
+                        matches = false;
+                    }
+
+                    if (matches)
+                    {
+                        matchedBooks.push_back(book.get());
+                    }
+                }
+                filterTimer.stop();
+                BookMetrics::addRows(BookMetrics::FilterBooks, books.size(), matchedBooks.size());
+
+                // Sort books by publication date
+                BookMetrics::Timer sortTimer(BookMetrics::FilterBooks, BookMetrics::Sort);
+                std::sort(matchedBooks.begin(), matchedBooks.end(), [sortOrder](const Book* a, const Book* b) {
+                    std::tm aTm = {};
+                    std::tm bTm = {};
+                    std::istringstream ssA(a->publicationDate);
+                    std::istringstream ssB(b->publicationDate);
+                    ssA >> std::get_time(&aTm, "%m/%d/%Y");
+                    ssB >> std::get_time(&bTm, "%m/%d/%Y");
+                    std::time_t aTime = std::mktime(&aTm);
+                    std::time_t bTime = std::mktime(&bTm);
+
+                    return (sortOrder == "ASC") ? (aTime < bTime) : (aTime > bTime);
+                });
+                sortTimer.stop();
+
+                BookMetrics::Timer serializeTimer(BookMetrics::FilterBooks, BookMetrics::Serialize);
+                Json::Value jsonSortedBooks(Json::arrayValue);
+                for (const Book* book : matchedBooks)
+                {
+                    jsonSortedBooks.append(book->toJson());
+                }
+
+                auto resp = drogon::HttpResponse::newHttpJsonResponse(jsonSortedBooks);
+                serializeTimer.stop();
+                return resp;
+            });
+        }
+        catch (const PoolOverloaded&)
+        {
+            co_return overloadedResponse(BookMetrics::FilterBooks);
+        }
+        catch (const std::exception& e)
         {
-            bool matches = true;
+            auto resp = drogon::HttpResponse::newHttpResponse();
+            resp->setStatusCode(drogon::k500InternalServerError);
+            resp->setBody(e.what());
+            co_return resp;
+        }
+    });
+}
 
-            if (!startDate.empty() && !endDate.empty() && !dateInRange(book.publicationDate, startDate, endDate))
-            {
-                matches = false;
-            }
+// Handler for the searchBooks endpoint
+drogon::Task<drogon::HttpResponsePtr> BookController::searchBooks(drogon::HttpRequestPtr req)
+{
+    BookMetrics::Timer totalTimer(BookMetrics::SearchBooks, BookMetrics::Total);
+    std::string query = req->getParameter("q");
+    bool fuzzy = req->getParameter("fuzzy") == "true" || req->getParameter("fuzzy") == "1";
+    int limit = DEFAULT_PAGE_SIZE;
+    int offset = 0;
+
+    if (TrigramIndex::normalize(query).empty())
+    {
+        auto resp = drogon::HttpResponse::newHttpResponse();
+        resp->setStatusCode(drogon::k400BadRequest);
+        resp->setBody("Search query is required");
+        co_return resp;
+    }
 
-            if (matches)
+    try
+    {
+        pageParameters(req, limit, offset);
+        co_return co_await storagePool().compute().run([&]() -> drogon::HttpResponsePtr {
+            // Candidates from the trigram index, verified by edit distance
+            BookMetrics::Timer filterTimer(BookMetrics::SearchBooks, BookMetrics::Filter);
+            auto results = store().search(query, fuzzy, limit, offset);
+            filterTimer.stop();
+            BookMetrics::addRows(BookMetrics::SearchBooks, results.verified, results.hits.size());
+
+            BookMetrics::Timer serializeTimer(BookMetrics::SearchBooks, BookMetrics::Serialize);
+            Json::Value jsonBooks(Json::arrayValue);
+            for (const auto& hit : results.hits)
             {
-                Json::Value jsonBook;
-                jsonBook["bookID"] = book.bookID;
-                jsonBook["title"] = book.title;
-                jsonBook["authors"] = book.authors;
-                jsonBook["avgRating"] = book.avgRating;
-                jsonBook["isbn"] = book.isbn;
-                jsonBook["isbn13"] = book.isbn13;
-                jsonBook["languageCode"] = book.languageCode;
-                jsonBook["numPages"] = book.numPages;
-                jsonBook["ratingsCount"] = book.ratingsCount;
-                jsonBook["textReviewsCount"] = book.textReviewsCount;
-                jsonBook["publicationDate"] = book.publicationDate;
-                jsonBook["publisher"] = book.publisher;
+                Json::Value jsonBook = hit.book->toJson();
+                jsonBook["score"] = hit.score;
                 jsonBooks.append(jsonBook);
             }
-        }
 
-        // Sort books by publication date
-        std::vector<Json::Value> sortedBooks(jsonBooks.begin(), jsonBooks.end());
-        std::sort(sortedBooks.begin(), sortedBooks.end(), [sortOrder](const Json::Value& a, const Json::Value& b) {
-            std::tm aTm = {};
-            std::tm bTm = {};
-            std::istringstream ssA(a["publicationDate"].asString());
-            std::istringstream ssB(b["publicationDate"].asString());
-            ssA >> std::get_time(&aTm, "%m/%d/%Y");
-            ssB >> std::get_time(&bTm, "%m/%d/%Y");
-            std::time_t aTime = std::mktime(&aTm);
-            std::time_t bTime = std::mktime(&bTm);
-
-            return (sortOrder == "ASC") ? (aTime < bTime) : (aTime > bTime);
+            auto resp = drogon::HttpResponse::newHttpJsonResponse(jsonBooks);
+            resp->addHeader("X-Total-Count", std::to_string(results.matched));
+            serializeTimer.stop();
+            return resp;
         });
-
-        Json::Value jsonSortedBooks(Json::arrayValue);
-        for (const auto& book : sortedBooks)
-        {
-            jsonSortedBooks.append(book);
-        }
-
-        auto resp = drogon::HttpResponse::newHttpJsonResponse(jsonSortedBooks);
-        callback(resp);
+    }
+    catch (const PoolOverloaded&)
+    {
+        co_return overloadedResponse(BookMetrics::SearchBooks);
+    }
+    catch (const std::invalid_argument& e)
+    {
+        auto resp = drogon::HttpResponse::newHttpResponse();
+        resp->setStatusCode(drogon::k400BadRequest);
+        resp->setBody(e.what());
+        co_return resp;
     }
     catch (const std::exception& e)
     {
         auto resp = drogon::HttpResponse::newHttpResponse();
         resp->setStatusCode(drogon::k500InternalServerError);
         resp->setBody(e.what());
-        callback(resp);
+        co_return resp;
     }
 }
 
 // Handler for the addBook endpoint
-void BookController::addBook(const drogon::HttpRequestPtr& req, std::function<void(const drogon::HttpResponsePtr&)>&& callback)
+drogon::Task<drogon::HttpResponsePtr> BookController::addBook(drogon::HttpRequestPtr req)
 {
+    BookMetrics::Timer totalTimer(BookMetrics::AddBook, BookMetrics::Total);
     auto json = req->getJsonObject();
     if (!json)
     {
         auto resp = drogon::HttpResponse::newHttpResponse();
         resp->setStatusCode(drogon::k400BadRequest);
         resp->setBody("Invalid JSON format");
-        callback(resp);
-        return;
+        co_return resp;
     }
 
     try
     {
-        // Read existing books
-        auto books = readBooksFromCSV();
+        co_return co_await storagePool().io().runCommitted([&](CommitCallback done) -> drogon::HttpResponsePtr {
+            // Store the new book under a freshly allocated bookID
+            BookMetrics::Timer writeTimer(BookMetrics::AddBook, BookMetrics::Write);
+            std::string newBookID = store().insert(bookFromJson(*json), std::move(done))->bookID;
+            writeTimer.stop();
 
-        // Determine the new bookID
-        int newID = 1;
-        if (!books.empty())
-        {
-            auto lastBook = std::max_element(books.begin(), books.end(), [](const Book& a, const Book& b) {
-                return std::stoi(a.bookID) < std::stoi(b.bookID);
-            });
-            newID = std::stoi(lastBook->bookID) + 1;
-        }
-        std::string newBookID = std::to_string(newID);
-
-        // Create new book with the unique bookID
-        Book book;
-        book.bookID = newBookID;
-        book.title = json->get("title", "").asString();
-        book.authors = json->get("authors", "").asString();
-        book.avgRating = json->get("avgRating", "").asString();
-        book.isbn = json->get("isbn", "").asString();
-        book.isbn13 = json->get("isbn13", "").asString();
-        book.languageCode = json->get("languageCode", "").asString();
-        book.numPages = json->get("numPages", "").asString();
-        book.ratingsCount = json->get("ratingsCount", "").asString();
-        book.textReviewsCount = json->get("textReviewsCount", "").asString();
-        book.publicationDate = json->get("publicationDate", "").asString();
-        book.publisher = json->get("publisher", "").asString();
-
-        // Add the new book to the end of the list
-        books.push_back(book);
-
-        // Write the updated books list to the CSV file
-        writeBooksToCSV(books);
+            auto resp = drogon::HttpResponse::newHttpResponse();
+            resp->setStatusCode(drogon::k200OK);
+            resp->setBody("Book added successfully with ID: " + newBookID);
+            return resp;
+        });
+    }
+    catch (const PoolOverloaded&)
+    {
+        co_return overloadedResponse(BookMetrics::AddBook);
+    }
+    catch (const StorageError& e)
+    {
+        auto resp = drogon::HttpResponse::newHttpResponse();
+        resp->setStatusCode(drogon::k500InternalServerError);
+        resp->setBody(e.what());
+        co_return resp;
+    }
+    catch (const std::exception& e)
+    {
+        auto resp = drogon::HttpResponse::newHttpResponse();
+        resp->setStatusCode(drogon::k400BadRequest);
+        resp->setBody(e.what());
+        co_return resp;
+    }
+}
+
+// Handler for the addBooks endpoint
+drogon::Task<drogon::HttpResponsePtr> BookController::addBooks(drogon::HttpRequestPtr req)
+{
+    BookMetrics::Timer totalTimer(BookMetrics::AddBooks, BookMetrics::Total);
+    auto json = req->getJsonObject();
+    if (!json || !json->isArray() || json->empty())
+    {
+        auto resp = drogon::HttpResponse::newHttpResponse();
+        resp->setStatusCode(drogon::k400BadRequest);
+        resp->setBody("Expected a non-empty JSON array of books");
+        co_return resp;
+    }
+
+    try
+    {
+        co_return co_await storagePool().io().runCommitted([&](CommitCallback done) -> drogon::HttpResponsePtr {
+            std::vector<Book> books;
+            books.reserve(json->size());
+            for (const auto& jsonBook : *json)
+            {
+                books.push_back(bookFromJson(jsonBook));
+            }
 
+            // Store the whole batch under one block of IDs
+            BookMetrics::Timer writeTimer(BookMetrics::AddBooks, BookMetrics::Write);
+            auto stored = store().insertBatch(std::move(books), std::move(done));
+            writeTimer.stop();
+
+            auto resp = drogon::HttpResponse::newHttpResponse();
+            resp->setStatusCode(drogon::k200OK);
+            resp->setBody("Added " + std::to_string(stored.size()) + " books with IDs: " + stored.front()->bookID + "-" +
+                          stored.back()->bookID);
+            return resp;
+        });
+    }
+    catch (const PoolOverloaded&)
+    {
+        co_return overloadedResponse(BookMetrics::AddBooks);
+    }
+    catch (const StorageError& e)
+    {
         auto resp = drogon::HttpResponse::newHttpResponse();
-        resp->setStatusCode(drogon::k200OK);
-        resp->setBody("Book added successfully with ID: " + newBookID);
-        callback(resp);
+        resp->setStatusCode(drogon::k500InternalServerError);
+        resp->setBody(e.what());
+        co_return resp;
     }
     catch (const std::exception& e)
     {
         auto resp = drogon::HttpResponse::newHttpResponse();
         resp->setStatusCode(drogon::k400BadRequest);
         resp->setBody(e.what());
-        callback(resp);
+        co_return resp;
     }
 }
 
 // Handler for the updateBook endpoint
-void BookController::updateBook(const drogon::HttpRequestPtr& req, std::function<void(const drogon::HttpResponsePtr&)>&& callback)
+drogon::Task<drogon::HttpResponsePtr> BookController::updateBook(drogon::HttpRequestPtr req)
 {
+    BookMetrics::Timer totalTimer(BookMetrics::UpdateBook, BookMetrics::Total);
     auto json = req->getJsonObject();
     if (!json)
     {
         auto resp = drogon::HttpResponse::newHttpResponse();
         resp->setStatusCode(drogon::k400BadRequest);
         resp->setBody("Invalid JSON format");
-        callback(resp);
-        return;
+        co_return resp;
     }
 
     // Extract bookID from the URL path
@@ -503,72 +654,66 @@ void BookController::updateBook(const drogon::HttpRequestPtr& req, std::function
         auto resp = drogon::HttpResponse::newHttpResponse();
         resp->setStatusCode(drogon::k400BadRequest);
         resp->setBody("Book ID is required");
-        callback(resp);
-        return;
+        co_return resp;
     }
 
-    try
+    long long id;
+    if (!BookIdAllocator::parseId(bookID, id))
     {
-        // Read existing books
-        auto books = readBooksFromCSV();
-
-        // Find the book to update
-        auto it = std::find_if(books.begin(), books.end(), [&bookID](const Book& book) {
-            return book.bookID == bookID;
-        });
+        auto resp = drogon::HttpResponse::newHttpResponse();
+        resp->setStatusCode(drogon::k404NotFound);
+        resp->setBody("Book not found");
+        co_return resp;
+    }
 
-        if (it != books.end())
-        {
+    try
+    {
+        co_return co_await storagePool().io().runCommitted([&](CommitCallback done) -> drogon::HttpResponsePtr {
             // Update the book details with the provided data
-            if (json->isMember("title")) it->title = json->get("title", "").asString();
-            if (json->isMember("authors")) it->authors = json->get("authors", "").asString();
-            if (json->isMember("avgRating")) it->avgRating = json->get("avgRating", "").asString();
-            if (json->isMember("isbn")) it->isbn = json->get("isbn", "").asString();
-            if (json->isMember("isbn13")) it->isbn13 = json->get("isbn13", "").asString();
-            if (json->isMember("languageCode")) it->languageCode = json->get("languageCode", "").asString();
-            if (json->isMember("numPages")) it->numPages = json->get("numPages", "").asString();
-            if (json->isMember("ratingsCount")) it->ratingsCount = json->get("ratingsCount", "").asString();
-            if (json->isMember("textReviewsCount")) it->textReviewsCount = json->get("textReviewsCount", "").asString();
-            if (json->isMember("publicationDate")) it->publicationDate = json->get("publicationDate", "").asString();
-            if (json->isMember("publisher")) it->publisher = json->get("publisher", "").asString();
-
-            // Write updated books list to CSV
-            writeBooksToCSV(books);
+            BookMetrics::Timer writeTimer(BookMetrics::UpdateBook, BookMetrics::Write);
+            bool found = store().update(id, [&json](Book& book) { applyJson(book, *json); }, std::move(done));
+            writeTimer.stop();
 
-            auto resp = drogon::HttpResponse::newHttpResponse();
-            resp->setStatusCode(drogon::k200OK);
-            resp->setBody("Book updated successfully");
-            callback(resp);
-        }
-        else
-        {
-            auto resp = drogon::HttpResponse::newHttpResponse();
-            resp->setStatusCode(drogon::k404NotFound);
-            resp->setBody("Book not found");
-            callback(resp);
-        }
+            if (found)
+            {
+                auto resp = drogon::HttpResponse::newHttpResponse();
+                resp->setStatusCode(drogon::k200OK);
+                resp->setBody("Book updated successfully");
+                return resp;
+            }
+            else
+            {
+                auto resp = drogon::HttpResponse::newHttpResponse();
+                resp->setStatusCode(drogon::k404NotFound);
+                resp->setBody("Book not found");
+                return resp;
+            }
+        });
+    }
+    catch (const PoolOverloaded&)
+    {
+        co_return overloadedResponse(BookMetrics::UpdateBook);
+    }
+    catch (const StorageError& e)
+    {
+        auto resp = drogon::HttpResponse::newHttpResponse();
+        resp->setStatusCode(drogon::k500InternalServerError);
+        resp->setBody(e.what());
+        co_return resp;
     }
     catch (const std::exception& e)
     {
         auto resp = drogon::HttpResponse::newHttpResponse();
         resp->setStatusCode(drogon::k400BadRequest);
         resp->setBody(e.what());
-        callback(resp);
+        co_return resp;
     }
 }
 
-// Check if a book with the given ID exists
-bool BookController::bookExists(const std::string& bookID)
-{
-    auto books = readBooksFromCSV();
-    return std::any_of(books.begin(), books.end(), [&bookID](const Book& book) {
-        return book.bookID == bookID;
-    });
-}
-
 // Handler for the deleteBook endpoint
-void BookController::deleteBook(const drogon::HttpRequestPtr& req, std::function<void(const drogon::HttpResponsePtr&)>&& callback)
+drogon::Task<drogon::HttpResponsePtr> BookController::deleteBook(drogon::HttpRequestPtr req)
 {
+    BookMetrics::Timer totalTimer(BookMetrics::DeleteBook, BookMetrics::Total);
     // Extract bookID from the URL path
     std::string path = req->getPath();
     std::string bookID = path.substr(path.find_last_of('/') + 1);
@@ -578,61 +723,73 @@ void BookController::deleteBook(const drogon::HttpRequestPtr& req, std::function
         auto resp = drogon::HttpResponse::newHttpResponse();
         resp->setStatusCode(drogon::k400BadRequest);
         resp->setBody("Book ID is required");
-        callback(resp);
-        return;
+        co_return resp;
+    }
+
+    long long id;
+    if (!BookIdAllocator::parseId(bookID, id))
+    {
+        auto resp = drogon::HttpResponse::newHttpResponse();
+        resp->setStatusCode(drogon::k404NotFound);
+        resp->setBody("Book not found");
+        co_return resp;
     }
 
     try
     {
-        // Read existing books
-        auto books = readBooksFromCSV();
+        co_return co_await storagePool().io().runCommitted([&](CommitCallback done) -> drogon::HttpResponsePtr {
+            // Remove the book with the given bookID
+            BookMetrics::Timer writeTimer(BookMetrics::DeleteBook, BookMetrics::Write);
+            bool found = store().remove(id, std::move(done));
+            writeTimer.stop();
 
-        // Find and remove the book with the given bookID
-        auto it = std::remove_if(books.begin(), books.end(), [&bookID](const Book& book) {
-            return book.bookID == bookID;
+            if (found)
+            {
+                auto resp = drogon::HttpResponse::newHttpResponse();
+                resp->setStatusCode(drogon::k200OK);
+                resp->setBody("Book deleted successfully");
+                return resp;
+            }
+            else
+            {
+                auto resp = drogon::HttpResponse::newHttpResponse();
+                resp->setStatusCode(drogon::k404NotFound);
+                resp->setBody("Book not found");
+                return resp;
+            }
         });
-
-        if (it != books.end())
-        {
-            // Erase the removed book from the vector
-            books.erase(it, books.end());
-
-            // Write updated books list to CSV
-            writeBooksToCSV(books);
-
-            auto resp = drogon::HttpResponse::newHttpResponse();
-            resp->setStatusCode(drogon::k200OK);
-            resp->setBody("Book deleted successfully");
-            callback(resp);
-        }
-        else
-        {
-            auto resp = drogon::HttpResponse::newHttpResponse();
-            resp->setStatusCode(drogon::k404NotFound);
-            resp->setBody("Book not found");
-            callback(resp);
-        }
+    }
+    catch (const PoolOverloaded&)
+    {
+        co_return overloadedResponse(BookMetrics::DeleteBook);
+    }
+    catch (const StorageError& e)
+    {
+        auto resp = drogon::HttpResponse::newHttpResponse();
+        resp->setStatusCode(drogon::k500InternalServerError);
+        resp->setBody(e.what());
+        co_return resp;
     }
     catch (const std::exception& e)
     {
         auto resp = drogon::HttpResponse::newHttpResponse();
         resp->setStatusCode(drogon::k400BadRequest);
         resp->setBody(e.what());
-        callback(resp);
+        co_return resp;
     }
 }
 
 // Handler for the putBook endpoint
-void BookController::putBook(const drogon::HttpRequestPtr& req, std::function<void(const drogon::HttpResponsePtr&)>&& callback)
+drogon::Task<drogon::HttpResponsePtr> BookController::putBook(drogon::HttpRequestPtr req)
 {
+    BookMetrics::Timer totalTimer(BookMetrics::PutBook, BookMetrics::Total);
     auto json = req->getJsonObject();
     if (!json)
     {
         auto resp = drogon::HttpResponse::newHttpResponse();
         resp->setStatusCode(drogon::k400BadRequest);
         resp->setBody("Invalid JSON format");
-        callback(resp);
-        return;
+        co_return resp;
     }
 
     // Extract bookID from the URL path
@@ -644,68 +801,212 @@ void BookController::putBook(const drogon::HttpRequestPtr& req, std::function<vo
         auto resp = drogon::HttpResponse::newHttpResponse();
         resp->setStatusCode(drogon::k400BadRequest);
         resp->setBody("Book ID is required");
-        callback(resp);
-        return;
+        co_return resp;
+    }
+
+    long long id;
+    if (!BookIdAllocator::parseId(bookID, id))
+    {
+        auto resp = drogon::HttpResponse::newHttpResponse();
+        resp->setStatusCode(drogon::k400BadRequest);
+        resp->setBody("Book ID must be an integer from 0 to " + std::to_string(BookIdAllocator::MAX_ID));
+        co_return resp;
     }
 
     try
     {
-        // Read existing books
-        auto books = readBooksFromCSV();
+        co_return co_await storagePool().io().runCommitted([&](CommitCallback done) -> drogon::HttpResponsePtr {
+            // Update the book, or create it if it does not exist
+            BookMetrics::Timer writeTimer(BookMetrics::PutBook, BookMetrics::Write);
+            store().upsert(id, [&json](Book& book) { applyJson(book, *json); }, std::move(done));
+            writeTimer.stop();
 
-        // Find the book to update
-        auto it = std::find_if(books.begin(), books.end(), [&bookID](const Book& book) {
-            return book.bookID == bookID;
+            auto resp = drogon::HttpResponse::newHttpResponse();
+            resp->setStatusCode(drogon::k200OK);
+            resp->setBody("Book updated or added successfully");
+            return resp;
         });
+    }
+    catch (const PoolOverloaded&)
+    {
+        co_return overloadedResponse(BookMetrics::PutBook);
+    }
+    catch (const StorageError& e)
+    {
+        auto resp = drogon::HttpResponse::newHttpResponse();
+        resp->setStatusCode(drogon::k500InternalServerError);
+        resp->setBody(e.what());
+        co_return resp;
+    }
+    catch (const std::exception& e)
+    {
+        auto resp = drogon::HttpResponse::newHttpResponse();
+        resp->setStatusCode(drogon::k400BadRequest);
+        resp->setBody(e.what());
+        co_return resp;
+    }
+}
 
-        if (it != books.end())
-        {
-            // Update the book details with the provided data
-            if (json->isMember("title")) it->title = json->get("title", "").asString();
-            if (json->isMember("authors")) it->authors = json->get("authors", "").asString();
-            if (json->isMember("avgRating")) it->avgRating = json->get("avgRating", "").asString();
-            if (json->isMember("isbn")) it->isbn = json->get("isbn", "").asString();
-            if (json->isMember("isbn13")) it->isbn13 = json->get("isbn13", "").asString();
-            if (json->isMember("languageCode")) it->languageCode = json->get("languageCode", "").asString();
-            if (json->isMember("numPages")) it->numPages = json->get("numPages", "").asString();
-            if (json->isMember("ratingsCount")) it->ratingsCount = json->get("ratingsCount", "").asString();
-            if (json->isMember("textReviewsCount")) it->textReviewsCount = json->get("textReviewsCount", "").asString();
-            if (json->isMember("publicationDate")) it->publicationDate = json->get("publicationDate", "").asString();
-            if (json->isMember("publisher")) it->publisher = json->get("publisher", "").asString();
-        }
-        else
-        {
-            // Create a new book if it does not exist
-            Book newBook;
-            newBook.bookID = bookID;
-            if (json->isMember("title")) newBook.title = json->get("title", "").asString();
-            if (json->isMember("authors")) newBook.authors = json->get("authors", "").asString();
-            if (json->isMember("avgRating")) newBook.avgRating = json->get("avgRating", "").asString();
-            if (json->isMember("isbn")) newBook.isbn = json->get("isbn", "").asString();
-            if (json->isMember("isbn13")) newBook.isbn13 = json->get("isbn13", "").asString();
-            if (json->isMember("languageCode")) newBook.languageCode = json->get("languageCode", "").asString();
-            if (json->isMember("numPages")) newBook.numPages = json->get("numPages", "").asString();
-            if (json->isMember("ratingsCount")) newBook.ratingsCount = json->get("ratingsCount", "").asString();
-            if (json->isMember("textReviewsCount")) newBook.textReviewsCount = json->get("textReviewsCount", "").asString();
-            if (json->isMember("publicationDate")) newBook.publicationDate = json->get("publicationDate", "").asString();
-            if (json->isMember("publisher")) newBook.publisher = json->get("publisher", "").asString();
-
-            books.push_back(newBook);
-        }
+// Handler for the getAuthors endpoint
+drogon::Task<drogon::HttpResponsePtr> BookController::getAuthors(drogon::HttpRequestPtr req)
+{
+    BookMetrics::Timer totalTimer(BookMetrics::GetAuthors, BookMetrics::Total);
+    int limit = DEFAULT_PAGE_SIZE;
+    int offset = 0;
+
+    try
+    {
+        pageParameters(req, limit, offset);
+        co_return co_await storagePool().compute().run([&]() -> drogon::HttpResponsePtr {
+            // Read one page of the author index
+            BookMetrics::Timer loadTimer(BookMetrics::GetAuthors, BookMetrics::Load);
+            auto names = store().authors(limit, offset);
+            loadTimer.stop();
+            return namesResponse(BookMetrics::GetAuthors, names);
+        });
+    }
+    catch (const PoolOverloaded&)
+    {
+        co_return overloadedResponse(BookMetrics::GetAuthors);
+    }
+    catch (const std::invalid_argument& e)
+    {
+        auto resp = drogon::HttpResponse::newHttpResponse();
+        resp->setStatusCode(drogon::k400BadRequest);
+        resp->setBody(e.what());
+        co_return resp;
+    }
+    catch (const std::exception& e)
+    {
+        auto resp = drogon::HttpResponse::newHttpResponse();
+        resp->setStatusCode(drogon::k500InternalServerError);
+        resp->setBody(e.what());
+        co_return resp;
+    }
+}
+
+// Handler for the getAuthorBooks endpoint
+drogon::Task<drogon::HttpResponsePtr> BookController::getAuthorBooks(drogon::HttpRequestPtr req, std::string name)
+{
+    BookMetrics::Timer totalTimer(BookMetrics::GetAuthorBooks, BookMetrics::Total);
+    int limit = DEFAULT_PAGE_SIZE;
+    int offset = 0;
+
+    try
+    {
+        pageParameters(req, limit, offset);
+        co_return co_await storagePool().compute().run([&]() -> drogon::HttpResponsePtr {
+            // Look up the author's posting list
+            BookMetrics::Timer loadTimer(BookMetrics::GetAuthorBooks, BookMetrics::Load);
+            auto books = store().booksByAuthor(name, limit, offset);
+            loadTimer.stop();
+            return booksResponse(BookMetrics::GetAuthorBooks, books);
+        });
+    }
+    catch (const PoolOverloaded&)
+    {
+        co_return overloadedResponse(BookMetrics::GetAuthorBooks);
+    }
+    catch (const std::invalid_argument& e)
+    {
+        auto resp = drogon::HttpResponse::newHttpResponse();
+        resp->setStatusCode(drogon::k400BadRequest);
+        resp->setBody(e.what());
+        co_return resp;
+    }
+    catch (const std::exception& e)
+    {
+        auto resp = drogon::HttpResponse::newHttpResponse();
+        resp->setStatusCode(drogon::k500InternalServerError);
+        resp->setBody(e.what());
+        co_return resp;
+    }
+}
 
-        // Write updated books list to CSV
-        writeBooksToCSV(books);
+// Handler for the getPublishers endpoint
+drogon::Task<drogon::HttpResponsePtr> BookController::getPublishers(drogon::HttpRequestPtr req)
+{
+    BookMetrics::Timer totalTimer(BookMetrics::GetPublishers, BookMetrics::Total);
+    int limit = DEFAULT_PAGE_SIZE;
+    int offset = 0;
 
+    try
+    {
+        pageParameters(req, limit, offset);
+        co_return co_await storagePool().compute().run([&]() -> drogon::HttpResponsePtr {
+            // Read one page of the publisher index
+            BookMetrics::Timer loadTimer(BookMetrics::GetPublishers, BookMetrics::Load);
+            auto names = store().publishers(limit, offset);
+            loadTimer.stop();
+            return namesResponse(BookMetrics::GetPublishers, names);
+        });
+    }
+    catch (const PoolOverloaded&)
+    {
+        co_return overloadedResponse(BookMetrics::GetPublishers);
+    }
+    catch (const std::invalid_argument& e)
+    {
         auto resp = drogon::HttpResponse::newHttpResponse();
-        resp->setStatusCode(drogon::k200OK);
-        resp->setBody("Book updated or added successfully");
-        callback(resp);
+        resp->setStatusCode(drogon::k400BadRequest);
+        resp->setBody(e.what());
+        co_return resp;
     }
     catch (const std::exception& e)
+    {
+        auto resp = drogon::HttpResponse::newHttpResponse();
+        resp->setStatusCode(drogon::k500InternalServerError);
+        resp->setBody(e.what());
+        co_return resp;
+    }
+}
+
+// Handler for the getPublisherBooks endpoint
+drogon::Task<drogon::HttpResponsePtr> BookController::getPublisherBooks(drogon::HttpRequestPtr req, std::string name)
+{
+    BookMetrics::Timer totalTimer(BookMetrics::GetPublisherBooks, BookMetrics::Total);
+    int limit = DEFAULT_PAGE_SIZE;
+    int offset = 0;
+
+    try
+    {
+        pageParameters(req, limit, offset);
+        co_return co_await storagePool().compute().run([&]() -> drogon::HttpResponsePtr {
+            // Look up the publisher's posting list
+            BookMetrics::Timer loadTimer(BookMetrics::GetPublisherBooks, BookMetrics::Load);
+            auto books = store().booksByPublisher(name, limit, offset);
+            loadTimer.stop();
+            return booksResponse(BookMetrics::GetPublisherBooks, books);
+        });
+    }
+    catch (const PoolOverloaded&)
+    {
+        co_return overloadedResponse(BookMetrics::GetPublisherBooks);
+    }
+    catch (const std::invalid_argument& e)
     {
         auto resp = drogon::HttpResponse::newHttpResponse();
         resp->setStatusCode(drogon::k400BadRequest);
         resp->setBody(e.what());
-        callback(resp);
+        co_return resp;
+    }
+    catch (const std::exception& e)
+    {
+        auto resp = drogon::HttpResponse::newHttpResponse();
+        resp->setStatusCode(drogon::k500InternalServerError);
+        resp->setBody(e.what());
+        co_return resp;
     }
 }
+
+// Handler for the getMetrics endpoint
+void BookController::getMetrics(const drogon::HttpRequestPtr& /*req*/, std::function<void(const drogon::HttpResponsePtr&)>&& callback)
+{
+    auto resp = drogon::HttpResponse::newHttpResponse();
+    resp->setStatusCode(drogon::k200OK);
+    resp->setContentTypeString("text/plain; version=0.0.4");
+    BookMetrics::setCatalogSize(store().size());
+    BookMetrics::setCatalogVersion(store().version());
+    resp->setBody(BookMetrics::renderPrometheus());
+    callback(resp);
+}
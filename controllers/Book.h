@@ -1,28 +1,14 @@
 #include <drogon/HttpController.h>
+#include <drogon/utils/coroutine.h>
 #include <vector>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <jsoncpp/json/json.h>
-
-struct Book {
-    std::string bookID;
-    std::string title;
-    std::string authors;
-    std::string avgRating;
-    std::string isbn;
-    std::string isbn13;
-    std::string languageCode;
-    std::string numPages;
-    std::string ratingsCount;
-    std::string textReviewsCount;
-    std::string publicationDate;
-    std::string publisher;
-
-    static std::string escapeCSV(const std::string& str);
-    std::string toCSV() const;
-    static Book fromCSV(const std::string& line);
-};
+#include "BookMetrics.h"
+#include "RequestCoalescer.h"
+#include "plugins/BookStore.h"
+#include "plugins/StoragePool.h"
 
 class BookController : public drogon::HttpController<BookController>
 {
@@ -30,25 +16,49 @@ public:
     METHOD_LIST_BEGIN
     ADD_METHOD_TO(BookController::getBooks, "/books", drogon::Get);
     ADD_METHOD_TO(BookController::filterBooks, "/books/filter", drogon::Get);
+    ADD_METHOD_TO(BookController::searchBooks, "/books/search", drogon::Get);
     ADD_METHOD_TO(BookController::addBook, "/books", drogon::Post);
+    ADD_METHOD_TO(BookController::addBooks, "/books/bulk", drogon::Post);
     ADD_METHOD_TO(BookController::updateBook, "/books/{bookID}", drogon::Patch);
     ADD_METHOD_TO(BookController::deleteBook, "/books/{bookID}", drogon::Delete);
     ADD_METHOD_TO(BookController::putBook, "/books/{bookID}", drogon::Put);
+    ADD_METHOD_TO(BookController::getAuthors, "/authors", drogon::Get);
+    ADD_METHOD_TO(BookController::getAuthorBooks, "/authors/{name}/books", drogon::Get);
+    ADD_METHOD_TO(BookController::getPublishers, "/publishers", drogon::Get);
+    ADD_METHOD_TO(BookController::getPublisherBooks, "/publishers/{name}/books", drogon::Get);
+    ADD_METHOD_TO(BookController::getMetrics, "/metrics", drogon::Get);
     METHOD_LIST_END
 
-    void getBooks(const drogon::HttpRequestPtr& req, std::function<void(const drogon::HttpResponsePtr&)>&& callback);
-    void filterBooks(const drogon::HttpRequestPtr& req, std::function<void(const drogon::HttpResponsePtr&)>&& callback);
-    void addBook(const drogon::HttpRequestPtr& req, std::function<void(const drogon::HttpResponsePtr&)>&& callback);
-    void updateBook(const drogon::HttpRequestPtr& req, std::function<void(const drogon::HttpResponsePtr&)>&& callback);
-    void deleteBook(const drogon::HttpRequestPtr& req, std::function<void(const drogon::HttpResponsePtr&)>&& callback);
-    void putBook(const drogon::HttpRequestPtr& req, std::function<void(const drogon::HttpResponsePtr&)>&& callback);
+    drogon::Task<drogon::HttpResponsePtr> getBooks(drogon::HttpRequestPtr req);
+    drogon::Task<drogon::HttpResponsePtr> filterBooks(drogon::HttpRequestPtr req);
+    drogon::Task<drogon::HttpResponsePtr> searchBooks(drogon::HttpRequestPtr req);
+    drogon::Task<drogon::HttpResponsePtr> addBook(drogon::HttpRequestPtr req);
+    drogon::Task<drogon::HttpResponsePtr> addBooks(drogon::HttpRequestPtr req);
+    drogon::Task<drogon::HttpResponsePtr> updateBook(drogon::HttpRequestPtr req);
+    drogon::Task<drogon::HttpResponsePtr> deleteBook(drogon::HttpRequestPtr req);
+    drogon::Task<drogon::HttpResponsePtr> putBook(drogon::HttpRequestPtr req);
+    drogon::Task<drogon::HttpResponsePtr> getAuthors(drogon::HttpRequestPtr req);
+    drogon::Task<drogon::HttpResponsePtr> getAuthorBooks(drogon::HttpRequestPtr req, std::string name);
+    drogon::Task<drogon::HttpResponsePtr> getPublishers(drogon::HttpRequestPtr req);
+    drogon::Task<drogon::HttpResponsePtr> getPublisherBooks(drogon::HttpRequestPtr req, std::string name);
+    void getMetrics(const drogon::HttpRequestPtr& req, std::function<void(const drogon::HttpResponsePtr&)>&& callback);
 
 private:
-    static const std::string CSV_FILE;
+    static BookStore& store();
+    static StoragePool& storagePool();
+    static RequestCoalescer& coalescer();
+    static drogon::Task<drogon::HttpResponsePtr> coalesced(BookMetrics::Route route, std::string key,
+                                                           std::function<drogon::Task<drogon::HttpResponsePtr>()> compute);
+    static drogon::HttpResponsePtr overloadedResponse(BookMetrics::Route route);
+    // Page size of paginated listings when no limit is given, and the largest allowed
+    static constexpr int DEFAULT_PAGE_SIZE = 20;
+    static constexpr int MAX_PAGE_SIZE = 100;
+    static void pageParameters(const drogon::HttpRequestPtr& req, int& limit, int& offset);
+    static drogon::HttpResponsePtr booksResponse(BookMetrics::Route route, const std::vector<BookPtr>& books);
+    static drogon::HttpResponsePtr namesResponse(BookMetrics::Route route, const std::vector<NameCount>& names);
     static std::string escapeCSV(const std::string& str);
-    static std::vector<Book> readBooksFromCSV(int limit = -1, int offset = 0);
-    static void writeBooksToCSV(const std::vector<Book>& books);
-    static Book findBookByTitle(const std::string& title);
+    static std::string stringField(const Json::Value& json, const char* name);
+    static Book bookFromJson(const Json::Value& json);
+    static void applyJson(Book& book, const Json::Value& json);
     static bool dateInRange(const std::string& date, const std::string& startDate, const std::string& endDate);
-    static bool bookExists(const std::string& bookID);
 };
\ No newline at end of file
@@ -0,0 +1,239 @@
+#include "BookMetrics.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+const char* const ROUTE_NAMES[BookMetrics::RouteCount] = {
+    "getBooks", "filterBooks", "addBook", "addBooks", "updateBook", "deleteBook", "putBook",
+    "getAuthors", "getAuthorBooks", "getPublishers", "getPublisherBooks", "searchBooks"};
+const char* const PHASE_NAMES[BookMetrics::PhaseCount] = {
+    "total", "load", "filter", "sort", "serialize", "write"};
+
+// Bucket upper bounds exported to Prometheus, in seconds
+const double EXPORTED_BOUNDS[] = {
+    0.000001, 0.000005, 0.00001, 0.000025, 0.00005, 0.0001, 0.00025, 0.0005,
+    0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0};
+
+struct Slab
+{
+    std::atomic<uint64_t> buckets[BookMetrics::RouteCount][BookMetrics::PhaseCount][BookMetrics::BUCKET_COUNT];
+    std::atomic<uint64_t> count[BookMetrics::RouteCount][BookMetrics::PhaseCount];
+    std::atomic<uint64_t> sumNanos[BookMetrics::RouteCount][BookMetrics::PhaseCount];
+    std::atomic<uint64_t> rowsScanned[BookMetrics::RouteCount];
+    std::atomic<uint64_t> rowsReturned[BookMetrics::RouteCount];
+    std::atomic<uint64_t> rejected[BookMetrics::RouteCount];
+    std::atomic<uint64_t> coalesced[BookMetrics::RouteCount];
+};
+
+// Slabs are owned here so their counts survive the threads that wrote them
+std::mutex& registryMutex()
+{
+    static std::mutex mutex;
+    return mutex;
+}
+
+std::vector<std::unique_ptr<Slab>>& registry()
+{
+    static std::vector<std::unique_ptr<Slab>> slabs;
+    return slabs;
+}
+
+Slab& localSlab()
+{
+    thread_local Slab* slab = nullptr;
+    if (!slab)
+    {
+        auto owned = std::make_unique<Slab>();
+        slab = owned.get();
+        std::lock_guard<std::mutex> lock(registryMutex());
+        registry().push_back(std::move(owned));
+    }
+    return *slab;
+}
+
+// Only the owning thread writes a slab, so a plain load/store pair is enough
+inline void bump(std::atomic<uint64_t>& counter, uint64_t n)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+std::atomic<uint64_t> catalogSize{0};
+std::atomic<uint64_t> catalogVersion{0};
+
+// Nanoseconds as exact decimal seconds; a double printed at the stream's
+// default precision would only keep whole seconds once sums grow large
+std::string secondsText(uint64_t nanos)
+{
+    std::string fraction = std::to_string(nanos % 1000000000);
+    return std::to_string(nanos / 1000000000) + "." + std::string(9 - fraction.size(), '0') + fraction;
+}
+}  // namespace
+
+int BookMetrics::bucketIndex(uint64_t nanos)
+{
+    if (nanos < SUB_BUCKETS)
+    {
+        return static_cast<int>(nanos);
+    }
+    int exponent = 63 - __builtin_clzll(nanos);
+    if (exponent > MAX_EXPONENT)
+    {
+        return BUCKET_COUNT - 1;
+    }
+    int sub = static_cast<int>((nanos >> (exponent - SUB_BITS)) & (SUB_BUCKETS - 1));
+    return (exponent - SUB_BITS + 1) * SUB_BUCKETS + sub;
+}
+
+uint64_t BookMetrics::bucketUpperBound(int index)
+{
+    if (index < SUB_BUCKETS)
+    {
+        return index + 1;
+    }
+    int exponent = index / SUB_BUCKETS + SUB_BITS - 1;
+    uint64_t sub = index % SUB_BUCKETS;
+    return (SUB_BUCKETS + sub + 1) << (exponent - SUB_BITS);
+}
+
+void BookMetrics::observe(Route route, Phase phase, uint64_t nanos)
+{
+    Slab& slab = localSlab();
+    bump(slab.buckets[route][phase][bucketIndex(nanos)], 1);
+    bump(slab.count[route][phase], 1);
+    bump(slab.sumNanos[route][phase], nanos);
+}
+
+void BookMetrics::addRows(Route route, uint64_t scanned, uint64_t returned)
+{
+    Slab& slab = localSlab();
+    bump(slab.rowsScanned[route], scanned);
+    bump(slab.rowsReturned[route], returned);
+}
+
+void BookMetrics::addRejected(Route route)
+{
+    bump(localSlab().rejected[route], 1);
+}
+
+void BookMetrics::addCoalesced(Route route)
+{
+    bump(localSlab().coalesced[route], 1);
+}
+
+void BookMetrics::setCatalogSize(uint64_t size)
+{
+    catalogSize.store(size, std::memory_order_relaxed);
+}
+
+void BookMetrics::setCatalogVersion(uint64_t version)
+{
+    catalogVersion.store(version, std::memory_order_relaxed);
+}
+
+// Render all metrics in the Prometheus text exposition format
+std::string BookMetrics::renderPrometheus()
+{
+    const size_t seriesCount = static_cast<size_t>(RouteCount) * PhaseCount;
+    std::vector<uint64_t> buckets(seriesCount * BUCKET_COUNT, 0);
+    std::vector<uint64_t> counts(seriesCount, 0);
+    std::vector<uint64_t> sums(seriesCount, 0);
+    std::vector<uint64_t> scanned(RouteCount, 0);
+    std::vector<uint64_t> returned(RouteCount, 0);
+    std::vector<uint64_t> rejected(RouteCount, 0);
+    std::vector<uint64_t> coalesced(RouteCount, 0);
+
+    {
+        std::lock_guard<std::mutex> lock(registryMutex());
+        for (const auto& slab : registry())
+        {
+            for (int r = 0; r < RouteCount; ++r)
+            {
+                for (int p = 0; p < PhaseCount; ++p)
+                {
+                    size_t series = static_cast<size_t>(r) * PhaseCount + p;
+                    counts[series] += slab->count[r][p].load(std::memory_order_relaxed);
+                    sums[series] += slab->sumNanos[r][p].load(std::memory_order_relaxed);
+                    for (int b = 0; b < BUCKET_COUNT; ++b)
+                    {
+                        buckets[series * BUCKET_COUNT + b] += slab->buckets[r][p][b].load(std::memory_order_relaxed);
+                    }
+                }
+                scanned[r] += slab->rowsScanned[r].load(std::memory_order_relaxed);
+                returned[r] += slab->rowsReturned[r].load(std::memory_order_relaxed);
+                rejected[r] += slab->rejected[r].load(std::memory_order_relaxed);
+                coalesced[r] += slab->coalesced[r].load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    std::ostringstream out;
+    out << "# HELP bookdb_request_duration_seconds Handler latency by route and phase.\n"
+        << "# TYPE bookdb_request_duration_seconds histogram\n";
+    for (int r = 0; r < RouteCount; ++r)
+    {
+        for (int p = 0; p < PhaseCount; ++p)
+        {
+            size_t series = static_cast<size_t>(r) * PhaseCount + p;
+            if (counts[series] == 0)
+            {
+                continue;
+            }
+            std::string labels = std::string("route=\"") + ROUTE_NAMES[r] + "\",phase=\"" + PHASE_NAMES[p] + "\"";
+
+            // A bucket counts towards a bound once its whole range is below it
+            uint64_t cumulative = 0;
+            int b = 0;
+            for (double bound : EXPORTED_BOUNDS)
+            {
+                uint64_t boundNanos = static_cast<uint64_t>(bound * 1e9);
+                for (; b < BUCKET_COUNT && bucketUpperBound(b) <= boundNanos; ++b)
+                {
+                    cumulative += buckets[series * BUCKET_COUNT + b];
+                }
+                out << "bookdb_request_duration_seconds_bucket{" << labels << ",le=\"" << bound << "\"} "
+                    << cumulative << "\n";
+            }
+            out << "bookdb_request_duration_seconds_bucket{" << labels << ",le=\"+Inf\"} " << counts[series] << "\n"
+                << "bookdb_request_duration_seconds_sum{" << labels << "} " << secondsText(sums[series]) << "\n"
+                << "bookdb_request_duration_seconds_count{" << labels << "} " << counts[series] << "\n";
+        }
+    }
+
+    out << "# HELP bookdb_rows_scanned_total Catalog rows examined by read handlers.\n"
+        << "# TYPE bookdb_rows_scanned_total counter\n";
+    for (int r = 0; r < RouteCount; ++r)
+    {
+        out << "bookdb_rows_scanned_total{route=\"" << ROUTE_NAMES[r] << "\"} " << scanned[r] << "\n";
+    }
+    out << "# HELP bookdb_rows_returned_total Rows sent back to clients by read handlers.\n"
+        << "# TYPE bookdb_rows_returned_total counter\n";
+    for (int r = 0; r < RouteCount; ++r)
+    {
+        out << "bookdb_rows_returned_total{route=\"" << ROUTE_NAMES[r] << "\"} " << returned[r] << "\n";
+    }
+    out << "# HELP bookdb_requests_rejected_total Requests answered with 503 because a storage pool was full.\n"
+        << "# TYPE bookdb_requests_rejected_total counter\n";
+    for (int r = 0; r < RouteCount; ++r)
+    {
+        out << "bookdb_requests_rejected_total{route=\"" << ROUTE_NAMES[r] << "\"} " << rejected[r] << "\n";
+    }
+    out << "# HELP bookdb_requests_coalesced_total Requests answered by an identical request already in flight.\n"
+        << "# TYPE bookdb_requests_coalesced_total counter\n";
+    for (int r = 0; r < RouteCount; ++r)
+    {
+        out << "bookdb_requests_coalesced_total{route=\"" << ROUTE_NAMES[r] << "\"} " << coalesced[r] << "\n";
+    }
+
+    out << "# HELP bookdb_catalog_books Number of books in the catalog.\n"
+        << "# TYPE bookdb_catalog_books gauge\n"
+        << "bookdb_catalog_books " << catalogSize.load(std::memory_order_relaxed) << "\n"
+        << "# HELP bookdb_catalog_version Number of catalog mutations since startup.\n"
+        << "# TYPE bookdb_catalog_version gauge\n"
+        << "bookdb_catalog_version " << catalogVersion.load(std::memory_order_relaxed) << "\n";
+    return out.str();
+}
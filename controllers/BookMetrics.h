@@ -0,0 +1,94 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Low-overhead request instrumentation for BookController.
+//
+// Every thread records into its own slab of counters, so an observation is a
+// couple of uncontended relaxed stores and never takes a lock. Latencies go
+// into log-linear (HDR-style) histograms with 8 sub-buckets per power of two,
+// which keeps the relative error under 12.5% from 1ns up to ~36 minutes.
+// renderPrometheus() sums the slabs of all threads at scrape time.
+class BookMetrics
+{
+public:
+    enum Route
+    {
+        GetBooks,
+        FilterBooks,
+        AddBook,
+        AddBooks,
+        UpdateBook,
+        DeleteBook,
+        PutBook,
+        GetAuthors,
+        GetAuthorBooks,
+        GetPublishers,
+        GetPublisherBooks,
+        SearchBooks,
+        RouteCount
+    };
+
+    enum Phase
+    {
+        Total,
+        Load,
+        Filter,
+        Sort,
+        Serialize,
+        Write,
+        PhaseCount
+    };
+
+    static void observe(Route route, Phase phase, uint64_t nanos);
+    static void addRows(Route route, uint64_t scanned, uint64_t returned);
+    static void addRejected(Route route);
+    static void addCoalesced(Route route);
+    static void setCatalogSize(uint64_t size);
+    static void setCatalogVersion(uint64_t version);
+    static std::string renderPrometheus();
+
+    // Histogram layout: values below 8ns get exact buckets, every power of two
+    // above that is split into 8 linear sub-buckets, capped at 2^40ns
+    static constexpr int SUB_BITS = 3;
+    static constexpr int SUB_BUCKETS = 1 << SUB_BITS;
+    static constexpr int MAX_EXPONENT = 40;
+    static constexpr int BUCKET_COUNT = (MAX_EXPONENT - SUB_BITS + 2) * SUB_BUCKETS;
+
+    // The bucket a latency in nanoseconds falls in
+    static int bucketIndex(uint64_t nanos);
+
+    // Exclusive upper bound of a bucket, in nanoseconds
+    static uint64_t bucketUpperBound(int index);
+
+    // Times one phase of a request; records on stop() or when leaving scope
+    class Timer
+    {
+    public:
+        Timer(Route route, Phase phase)
+            : route_(route), phase_(phase), start_(std::chrono::steady_clock::now())
+        {
+        }
+        ~Timer() { stop(); }
+        Timer(const Timer&) = delete;
+        Timer& operator=(const Timer&) = delete;
+
+        void stop()
+        {
+            if (stopped_)
+            {
+                return;
+            }
+            stopped_ = true;
+            auto elapsed = std::chrono::steady_clock::now() - start_;
+            observe(route_, phase_, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        }
+
+    private:
+        Route route_;
+        Phase phase_;
+        std::chrono::steady_clock::time_point start_;
+        bool stopped_ = false;
+    };
+};
@@ -0,0 +1,124 @@
+#include "RequestCoalescer.h"
+#include <stdexcept>
+
+namespace
+{
+// A response with the same status, headers and body, sharing nothing with the original
+drogon::HttpResponsePtr cloneResponse(const drogon::HttpResponse& response)
+{
+    auto clone = drogon::HttpResponse::newHttpResponse();
+    clone->setStatusCode(response.statusCode());
+    clone->setContentTypeCode(response.contentType());
+    for (const auto& header : response.headers())
+    {
+        clone->addHeader(header.first, header.second);
+    }
+    clone->setBody(std::string(response.body()));
+    return clone;
+}
+}  // namespace
+
+bool RequestCoalescer::Awaiter::await_ready()
+{
+    std::lock_guard<std::mutex> lock(flight_->mutex_);
+    return flight_->done_;
+}
+
+bool RequestCoalescer::Awaiter::await_suspend(std::coroutine_handle<> handle)
+{
+    std::lock_guard<std::mutex> lock(flight_->mutex_);
+    if (flight_->done_)
+    {
+        return false;
+    }
+    flight_->waiters_.emplace_back(handle, trantor::EventLoop::getEventLoopOfCurrentThread());
+    return true;
+}
+
+drogon::HttpResponsePtr RequestCoalescer::Awaiter::await_resume()
+{
+    if (flight_->error_)
+    {
+        std::rethrow_exception(flight_->error_);
+    }
+    return flight_->response_;
+}
+
+std::shared_ptr<RequestCoalescer::Flight> RequestCoalescer::join(const std::string& key, bool& leader)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& flight = flights_[key];
+    leader = !flight;
+    if (leader)
+    {
+        flight = std::make_shared<Flight>();
+    }
+    else
+    {
+        ++flight->followers_;
+    }
+    return flight;
+}
+
+void RequestCoalescer::finish(const std::string& key, const std::shared_ptr<Flight>& flight,
+                              const drogon::HttpResponsePtr& response, std::exception_ptr error)
+{
+    // Requests arriving from here on start a new flight
+    size_t followers;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = flights_.find(key);
+        if (it != flights_.end() && it->second == flight)
+        {
+            flights_.erase(it);
+        }
+        followers = flight->followers_;
+    }
+
+    if (!error && !response)
+    {
+        error = std::make_exception_ptr(std::runtime_error("Coalesced request produced no response"));
+    }
+
+    // The leader's own response is handed to drogon for sending, so the
+    // followers share one clone taken before it leaves the handler
+    drogon::HttpResponsePtr shared;
+    if (followers > 0 && response)
+    {
+        shared = cloneResponse(*response);
+    }
+
+    std::vector<std::pair<std::coroutine_handle<>, trantor::EventLoop*>> waiters;
+    {
+        std::lock_guard<std::mutex> lock(flight->mutex_);
+        flight->done_ = true;
+        flight->response_ = std::move(shared);
+        flight->error_ = error;
+        waiters.swap(flight->waiters_);
+    }
+    for (const auto& waiter : waiters)
+    {
+        auto handle = waiter.first;
+        if (waiter.second)
+        {
+            waiter.second->queueInLoop([handle]() { handle.resume(); });
+        }
+        else
+        {
+            handle.resume();
+        }
+    }
+}
+
+std::string RequestCoalescer::key(std::initializer_list<std::string_view> parts)
+{
+    // Length-prefixed, so no parameter value can imitate a separator
+    std::string key;
+    for (auto part : parts)
+    {
+        key += std::to_string(part.size());
+        key += ':';
+        key += part;
+    }
+    return key;
+}
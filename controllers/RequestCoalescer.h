@@ -0,0 +1,71 @@
+#pragma once
+#include <drogon/HttpResponse.h>
+#include <trantor/net/EventLoop.h>
+#include <coroutine>
+#include <exception>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Single-flight coalescing of identical concurrent reads.
+//
+// The first request for a key becomes the flight's leader and computes the
+// response. Requests with the same key that arrive while it runs join the
+// flight instead of repeating the work, and are resumed on their own event
+// loops with the leader's response. The leader's own response object goes to
+// its connection, so the followers share a single clone of it, made once when
+// the flight finishes; they must not modify it. A flight is retired the moment
+// it completes, so nothing is cached: only work already in progress is shared.
+class RequestCoalescer
+{
+public:
+    class Flight
+    {
+    private:
+        friend class RequestCoalescer;
+
+        std::mutex mutex_;
+        bool done_ = false;
+        drogon::HttpResponsePtr response_;
+        std::exception_ptr error_;
+        std::vector<std::pair<std::coroutine_handle<>, trantor::EventLoop*>> waiters_;
+        size_t followers_ = 0;  // Guarded by the coalescer's mutex
+    };
+
+    // Awaited by followers; yields the shared response or rethrows the leader's error
+    class Awaiter
+    {
+    public:
+        explicit Awaiter(std::shared_ptr<Flight> flight) : flight_(std::move(flight)) {}
+
+        bool await_ready();
+        bool await_suspend(std::coroutine_handle<> handle);
+        drogon::HttpResponsePtr await_resume();
+
+    private:
+        std::shared_ptr<Flight> flight_;
+    };
+
+    // Join the flight for key, starting one if none is running. leader is set
+    // for the caller that must compute the response and finish() the flight.
+    std::shared_ptr<Flight> join(const std::string& key, bool& leader);
+
+    // Wait for a flight joined as a follower to finish
+    static Awaiter wait(std::shared_ptr<Flight> flight) { return Awaiter(std::move(flight)); }
+
+    // Retire the flight and hand the leader's response, or error, to its followers
+    void finish(const std::string& key, const std::shared_ptr<Flight>& flight, const drogon::HttpResponsePtr& response,
+                std::exception_ptr error = nullptr);
+
+    // Unambiguous key from the normalized parts of a request
+    static std::string key(std::initializer_list<std::string_view> parts);
+
+private:
+    std::mutex mutex_;
+    std::unordered_map<std::string, std::shared_ptr<Flight>> flights_;
+};
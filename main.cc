@@ -1,6 +1,7 @@
 #include <drogon/drogon.h>
 int main() {
-    drogon::app().addListener("0.0.0.0", 8080);
+    // Listeners, threads and the BookStore plugin are configured in config.json
+    drogon::app().loadConfigFile("config.json");
     drogon::app().run();
     return 0;
 }
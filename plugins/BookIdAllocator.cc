@@ -0,0 +1,135 @@
+#include "BookIdAllocator.h"
+#include "StorageError.h"
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <unistd.h>
+
+BookIdAllocator::BookIdAllocator(std::string seqFile)
+    : seqFile_(std::move(seqFile))
+{
+}
+
+// Seed the next ID from the sequence file and the catalog, whichever is higher
+void BookIdAllocator::initialize(const std::function<long long()>& scanMaxId)
+{
+    std::call_once(initFlag_, [this, &scanMaxId]() {
+        long long stored = 0;
+        std::ifstream file(seqFile_);
+        std::string line;
+        if (std::getline(file, line) && parseId(line, stored))
+        {
+            persisted_.store(stored);
+        }
+        next_.store(std::max(stored, scanMaxId() + 1));
+    });
+}
+
+long long BookIdAllocator::next()
+{
+    return reserve(1);
+}
+
+long long BookIdAllocator::reserve(long long count)
+{
+    if (count < 1)
+    {
+        throw std::invalid_argument("At least one ID must be reserved");
+    }
+    long long first = next_.load();
+    do
+    {
+        if (count > MAX_ID - first)
+        {
+            throw std::overflow_error("No book IDs left to allocate");
+        }
+    } while (!next_.compare_exchange_weak(first, first + count));
+    persist(first + count);
+    return first;
+}
+
+void BookIdAllocator::observe(long long id)
+{
+    if (id > MAX_ID)
+    {
+        throw std::invalid_argument("Book ID must not exceed " + std::to_string(MAX_ID));
+    }
+    long long current = next_.load();
+    while (current <= id)
+    {
+        if (id - current >= MAX_ID_GAP)
+        {
+            throw std::invalid_argument("Book ID is too far beyond the highest allocated ID " +
+                                        std::to_string(current - 1));
+        }
+        if (next_.compare_exchange_weak(current, id + 1))
+        {
+            persist(id + 1);
+            return;
+        }
+    }
+}
+
+bool BookIdAllocator::parseId(const std::string& str, long long& id)
+{
+    if (str.empty())
+    {
+        return false;
+    }
+    const char* end = str.data() + str.size();
+    auto result = std::from_chars(str.data(), end, id);
+    return result.ec == std::errc() && result.ptr == end && id >= 0 && id <= MAX_ID;
+}
+
+// Make sure every ID below needed is covered by the synced high-water mark.
+// The file is replaced atomically, so a crash leaves either the old or the
+// new mark, and the rename is synced before any newly covered ID is used.
+void BookIdAllocator::persist(long long needed)
+{
+    if (needed <= persisted_.load())
+    {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(persistMutex_);
+    if (needed <= persisted_.load())
+    {
+        return;
+    }
+
+    long long highWater = std::min(needed + ID_CHUNK - 1, MAX_ID);
+    std::string tmpFile = seqFile_ + ".tmp";
+    std::string contents = std::to_string(highWater) + "\n";
+    int fd = ::open(tmpFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        throw StorageError("Unable to open ID sequence file for writing");
+    }
+    bool written = ::write(fd, contents.data(), contents.size()) == static_cast<ssize_t>(contents.size()) &&
+                   ::fsync(fd) == 0;
+    ::close(fd);
+    if (!written)
+    {
+        throw StorageError("Unable to write ID sequence file");
+    }
+    if (std::rename(tmpFile.c_str(), seqFile_.c_str()) != 0)
+    {
+        throw StorageError("Unable to update ID sequence file");
+    }
+
+    std::string dir = std::filesystem::path(seqFile_).parent_path().string();
+    int dirFd = ::open(dir.empty() ? "." : dir.c_str(), O_RDONLY | O_DIRECTORY);
+    bool synced = dirFd >= 0 && ::fsync(dirFd) == 0;
+    if (dirFd >= 0)
+    {
+        ::close(dirFd);
+    }
+    if (!synced)
+    {
+        throw StorageError("Unable to sync directory of ID sequence file");
+    }
+    persisted_.store(highWater);
+}
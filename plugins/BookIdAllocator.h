@@ -0,0 +1,59 @@
+#pragma once
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+
+// Hands out unique, monotonically increasing book IDs.
+//
+// The allocator is seeded once from the largest ID in the catalog and then
+// advanced with a single atomic add per reservation, so allocating an ID does
+// not depend on catalog size and two concurrent inserts can never receive the
+// same ID. A high-water mark is synced to a sequence file before any ID below
+// it is used, so IDs are not reused after a restart even if the newest books
+// were deleted. The mark is moved ID_CHUNK IDs at a time, so only one
+// allocation per chunk waits for the disk; a restart skips the unused rest
+// of the chunk.
+class BookIdAllocator
+{
+public:
+    // IDs stay within the range a JSON number represents exactly
+    static constexpr long long MAX_ID = (1LL << 53) - 1;
+
+    // How far past the highest allocated ID a client may choose one, so a
+    // single request cannot skip most of the ID space
+    static constexpr long long MAX_ID_GAP = 1'000'000;
+
+    // IDs covered by each update of the sequence file
+    static constexpr long long ID_CHUNK = 1024;
+
+    explicit BookIdAllocator(std::string seqFile);
+
+    // Seed from the catalog; only the first call runs scanMaxId
+    void initialize(const std::function<long long()>& scanMaxId);
+
+    // Reserve one ID
+    long long next();
+
+    // Reserve a contiguous block of count IDs and return the first one; throws
+    // std::overflow_error once the IDs below MAX_ID are used up
+    long long reserve(long long count);
+
+    // Make sure an ID chosen by a client is never handed out later; throws
+    // std::invalid_argument for IDs above MAX_ID or too far past the sequence
+    void observe(long long id);
+
+    // Parse a book ID from 0 to MAX_ID; returns false for anything else
+    static bool parseId(const std::string& str, long long& id);
+
+private:
+    void persist(long long needed);
+
+    std::string seqFile_;
+    std::once_flag initFlag_;
+    std::atomic<long long> next_{1};
+
+    // Every ID below persisted_ may be handed out; raised under persistMutex_
+    std::mutex persistMutex_;
+    std::atomic<long long> persisted_{0};
+};
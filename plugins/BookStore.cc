@@ -0,0 +1,1514 @@
+#include "BookStore.h"
+#include <trantor/utils/Logger.h>
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <queue>
+#include <sstream>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace
+{
+const char* const CSV_HEADER =
+    "bookID,title,authors,avgRating,isbn,isbn13,languageCode,numPages,ratingsCount,textReviewsCount,publicationDate,publisher\n";
+
+// Files recording the active shard count and the next unallocated bookID
+const char* const MANIFEST_FILE = "books.shards";
+const char* const SEQ_FILE = "books.seq";
+
+bool bookIdOf(const Book& book, long long& id)
+{
+    return BookIdAllocator::parseId(book.bookID, id);
+}
+
+// Read a whole file and split it into complete lines; a trailing line without
+// a newline is a torn write and is dropped. A missing file has no lines, but
+// one that exists and cannot be read is an error, not an empty shard.
+std::vector<std::string> readCompleteLines(const std::string& path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        if (errno == ENOENT)
+        {
+            return {};
+        }
+        throw StorageError("Unable to open " + path);
+    }
+    std::string data;
+    char buffer[65536];
+    ssize_t got;
+    while ((got = ::read(fd, buffer, sizeof(buffer))) != 0)
+    {
+        if (got < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            ::close(fd);
+            throw StorageError("Unable to read " + path);
+        }
+        data.append(buffer, static_cast<size_t>(got));
+    }
+    ::close(fd);
+
+    std::vector<std::string> lines;
+    size_t start = 0;
+    size_t end;
+    while ((end = data.find('\n', start)) != std::string::npos)
+    {
+        lines.emplace_back(data, start, end - start);
+        start = end + 1;
+    }
+    return lines;
+}
+
+// Trim a name and collapse runs of whitespace, e.g. "Alan  Lee " -> "Alan Lee"
+std::string collapseWhitespace(const std::string& name)
+{
+    std::string collapsed;
+    bool space = false;
+    for (char c : name)
+    {
+        if (std::isspace(static_cast<unsigned char>(c)))
+        {
+            space = !collapsed.empty();
+            continue;
+        }
+        if (space)
+        {
+            collapsed += ' ';
+            space = false;
+        }
+        collapsed += c;
+    }
+    return collapsed;
+}
+
+// Write all of data to fd, retrying short writes
+void writeAll(int fd, const std::string& data, const std::string& path)
+{
+    const char* next = data.data();
+    size_t remaining = data.size();
+    while (remaining > 0)
+    {
+        ssize_t written = ::write(fd, next, remaining);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            throw StorageError("Unable to write " + path);
+        }
+        next += written;
+        remaining -= written;
+    }
+}
+
+// Make a rename in the directory containing path durable
+void syncDirectory(const std::string& path)
+{
+    std::string dir = std::filesystem::path(path).parent_path().string();
+    int fd = ::open(dir.empty() ? "." : dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0)
+    {
+        throw StorageError("Unable to open directory of " + path);
+    }
+    int result = ::fsync(fd);
+    ::close(fd);
+    if (result != 0)
+    {
+        throw StorageError("Unable to sync directory of " + path);
+    }
+}
+
+// A batch insert spread over several shards. The shards commit their parts
+// independently, so when one fails the others may already be durable.
+struct BatchCommit
+{
+    std::atomic<size_t> remaining;
+    std::mutex mutex;
+    std::exception_ptr error;
+    std::vector<long long> storedIDs;
+    CommitCallback done;
+};
+
+// IDs as sorted, comma-separated runs, e.g. "3-5,9"
+std::string idRanges(std::vector<long long> ids)
+{
+    std::sort(ids.begin(), ids.end());
+    std::string ranges;
+    for (size_t i = 0; i < ids.size();)
+    {
+        size_t end = i + 1;
+        while (end < ids.size() && ids[end] == ids[end - 1] + 1)
+        {
+            ++end;
+        }
+        ranges += (ranges.empty() ? "" : ",") + std::to_string(ids[i]);
+        if (end - i > 1)
+        {
+            ranges += "-" + std::to_string(ids[end - 1]);
+        }
+        i = end;
+    }
+    return ranges;
+}
+
+// The commit callback for one shard's part of a batch. The batch's callback
+// fires once every part is done, with the first error; if some parts were
+// stored regardless, the error names their IDs so the client knows which
+// books exist.
+CommitCallback commitPart(std::shared_ptr<BatchCommit> batch, std::vector<long long> ids)
+{
+    return [batch, ids = std::move(ids)](std::exception_ptr error) {
+        {
+            std::lock_guard<std::mutex> lock(batch->mutex);
+            if (!error)
+            {
+                batch->storedIDs.insert(batch->storedIDs.end(), ids.begin(), ids.end());
+            }
+            else if (!batch->error)
+            {
+                batch->error = error;
+            }
+        }
+        if (batch->remaining.fetch_sub(1) != 1)
+        {
+            return;
+        }
+        if (!batch->error || batch->storedIDs.empty())
+        {
+            batch->done(batch->error);
+            return;
+        }
+        std::string reason;
+        try
+        {
+            std::rethrow_exception(batch->error);
+        }
+        catch (const std::exception& e)
+        {
+            reason = e.what();
+        }
+        batch->done(std::make_exception_ptr(
+            StorageError(reason + "; only the books with these IDs were stored: " + idRanges(batch->storedIDs))));
+    };
+}
+}  // namespace
+
+// Utility function to escape CSV strings. fromCSV() trims unquoted fields, so
+// leading or trailing spaces are quoted to survive a round trip.
+std::string Book::escapeCSV(const std::string& str)
+{
+    bool padded = !str.empty() && (str.front() == ' ' || str.back() == ' ');
+    if (!padded && str.find(',') == std::string::npos && str.find('"') == std::string::npos)
+    {
+        return str;
+    }
+
+    std::string escapedStr = "\"";
+    for (char c : str)
+    {
+        if (c == '"')
+        {
+            escapedStr += '"';
+        }
+        escapedStr += c;
+    }
+    escapedStr += '"';
+    return escapedStr;
+}
+
+// Convert Book object to CSV format
+std::string Book::toCSV() const
+{
+    std::ostringstream oss;
+    oss << escapeCSV(bookID) << ','
+        << escapeCSV(title) << ','
+        << escapeCSV(authors) << ','
+        << escapeCSV(avgRating) << ','
+        << escapeCSV(isbn) << ','
+        << escapeCSV(isbn13) << ','
+        << escapeCSV(languageCode) << ','
+        << escapeCSV(numPages) << ','
+        << escapeCSV(ratingsCount) << ','
+        << escapeCSV(textReviewsCount) << ','
+        << escapeCSV(publicationDate) << ','
+        << escapeCSV(publisher);
+    return oss.str();
+}
+
+// Convert Book object to JSON
+Json::Value Book::toJson() const
+{
+    Json::Value jsonBook;
+    jsonBook["bookID"] = bookID;
+    jsonBook["title"] = title;
+    jsonBook["authors"] = authors;
+    jsonBook["avgRating"] = avgRating;
+    jsonBook["isbn"] = isbn;
+    jsonBook["isbn13"] = isbn13;
+    jsonBook["languageCode"] = languageCode;
+    jsonBook["numPages"] = numPages;
+    jsonBook["ratingsCount"] = ratingsCount;
+    jsonBook["textReviewsCount"] = textReviewsCount;
+    jsonBook["publicationDate"] = publicationDate;
+    jsonBook["publisher"] = publisher;
+    return jsonBook;
+}
+
+// Create Book object from CSV line
+Book Book::fromCSV(const std::string& line)
+{
+    std::vector<std::string> tokens;
+    size_t pos = 0;
+
+    while (pos <= line.size())
+    {
+        std::string token;
+        bool quoted = false;
+
+        // Skip leading spaces
+        while (pos < line.size() && line[pos] == ' ')
+        {
+            ++pos;
+        }
+
+        // Quoted field: "" is an escaped quote, a lone quote closes the field.
+        // Anything between the closing quote and the next comma is kept as is,
+        // which tolerates the stray quotes found in the original dataset.
+        if (pos < line.size() && line[pos] == '"')
+        {
+            quoted = true;
+            ++pos;
+            while (pos < line.size())
+            {
+                if (line[pos] == '"')
+                {
+                    if (pos + 1 < line.size() && line[pos + 1] == '"')
+                    {
+                        token += '"';
+                        pos += 2;
+                        continue;
+                    }
+                    ++pos;
+                    break;
+                }
+                token += line[pos++];
+            }
+        }
+
+        size_t end = line.find(',', pos);
+        if (end == std::string::npos)
+        {
+            end = line.size();
+        }
+        token.append(line, pos, end - pos);
+
+        // Remove trailing spaces from unquoted tokens
+        if (!quoted)
+        {
+            token.erase(token.find_last_not_of(' ') + 1);
+        }
+        tokens.push_back(std::move(token));
+        pos = end + 1;
+    }
+
+    Book book;
+    if (tokens.size() >= 12)
+    {
+        book.bookID = tokens[0];
+        book.title = tokens[1];
+        book.authors = tokens[2];
+        book.avgRating = tokens[3];
+        book.isbn = tokens[4];
+        book.isbn13 = tokens[5];
+        book.languageCode = tokens[6];
+        book.numPages = tokens[7];
+        book.ratingsCount = tokens[8];
+        book.textReviewsCount = tokens[9];
+        book.publicationDate = tokens[10];
+        book.publisher = tokens[11];
+    }
+
+    return book;
+}
+
+// Split the authors field, dropping empty and repeated names
+std::vector<std::string> Book::authorNames() const
+{
+    std::vector<std::string> names;
+    std::set<std::string> seen;
+    size_t start = 0;
+    while (start <= authors.size())
+    {
+        size_t end = authors.find('/', start);
+        if (end == std::string::npos)
+        {
+            end = authors.size();
+        }
+        std::string name = collapseWhitespace(authors.substr(start, end - start));
+        if (!name.empty() && seen.insert(BookStore::normalizeName(name)).second)
+        {
+            names.push_back(std::move(name));
+        }
+        start = end + 1;
+    }
+    return names;
+}
+
+BookShard::BookShard(std::string dataFile, std::string logFile, const ShardOptions& options)
+    : dataFile_(std::move(dataFile)), logFile_(std::move(logFile)), options_(options)
+{
+}
+
+BookShard::~BookShard()
+{
+    close();
+}
+
+// Rebuild the shard from its snapshot and mutation log. The files are read
+// before memory is cleared, so a load that fails leaves the rows in place.
+void BookShard::load()
+{
+    auto rows = readCompleteLines(dataFile_);
+    auto records = readCompleteLines(logFile_);
+
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    books_.clear();
+    authorIndex_.clear();
+    publisherIndex_.clear();
+    searchIndex_.clear();
+    for (size_t i = 1; i < rows.size(); ++i)  // Skip the header line
+    {
+        auto book = std::make_shared<Book>(Book::fromCSV(rows[i]));
+        long long id;
+        if (bookIdOf(*book, id))
+        {
+            setBook(id, std::move(book));
+        }
+    }
+
+    for (const auto& record : records)
+    {
+        applyRecord(record);
+    }
+}
+
+// Apply one mutation log record; the caller holds mutex_ exclusively
+void BookShard::applyRecord(const std::string& record)
+{
+    long long id;
+    if (record.compare(0, 2, "P,") == 0)
+    {
+        auto book = std::make_shared<Book>(Book::fromCSV(record.substr(2)));
+        if (bookIdOf(*book, id))
+        {
+            setBook(id, std::move(book));
+        }
+    }
+    else if (record.compare(0, 2, "D,") == 0 && BookIdAllocator::parseId(record.substr(2), id))
+    {
+        eraseBook(id);
+    }
+}
+
+// Store or replace a book and keep the indexes in step; the caller holds mutex_ exclusively
+void BookShard::setBook(long long id, BookPtr book)
+{
+    auto it = books_.find(id);
+    if (it != books_.end())
+    {
+        unindexBook(id, *it->second);
+        it->second = std::move(book);
+    }
+    else
+    {
+        it = books_.emplace(id, std::move(book)).first;
+    }
+    indexBook(id, *it->second);
+}
+
+void BookShard::eraseBook(long long id)
+{
+    auto it = books_.find(id);
+    if (it != books_.end())
+    {
+        unindexBook(id, *it->second);
+        books_.erase(it);
+    }
+}
+
+void BookShard::indexBook(long long id, const Book& book)
+{
+    auto add = [id](NameIndex& index, const std::string& name) {
+        Posting& posting = index[BookStore::normalizeName(name)];
+        if (posting.name.empty())
+        {
+            posting.name = name;
+        }
+        posting.bookIDs.insert(id);
+    };
+    for (const auto& author : book.authorNames())
+    {
+        add(authorIndex_, author);
+    }
+    std::string publisher = collapseWhitespace(book.publisher);
+    if (!publisher.empty())
+    {
+        add(publisherIndex_, publisher);
+    }
+    searchIndex_.add(id, TrigramIndex::normalize(book.title + " " + book.authors));
+}
+
+void BookShard::unindexBook(long long id, const Book& book)
+{
+    auto drop = [id](NameIndex& index, const std::string& name) {
+        auto it = index.find(BookStore::normalizeName(name));
+        if (it != index.end() && it->second.bookIDs.erase(id) && it->second.bookIDs.empty())
+        {
+            index.erase(it);
+        }
+    };
+    for (const auto& author : book.authorNames())
+    {
+        drop(authorIndex_, author);
+    }
+    std::string publisher = collapseWhitespace(book.publisher);
+    if (!publisher.empty())
+    {
+        drop(publisherIndex_, publisher);
+    }
+    searchIndex_.remove(id);
+}
+
+void BookShard::assign(std::vector<BookPtr> books)
+{
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    books_.clear();
+    authorIndex_.clear();
+    publisherIndex_.clear();
+    searchIndex_.clear();
+    for (auto& book : books)
+    {
+        long long id;
+        if (bookIdOf(*book, id))
+        {
+            setBook(id, std::move(book));
+        }
+    }
+}
+
+// Write a fresh snapshot, start an empty log and the committer
+void BookShard::open()
+{
+    compact(snapshotText());
+    committer_ = std::thread([this]() { commitLoop(); });
+}
+
+void BookShard::close()
+{
+    if (committer_.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(commitMutex_);
+            stopping_ = true;
+        }
+        commitReady_.notify_one();
+        committer_.join();
+    }
+    if (logFd_ >= 0)
+    {
+        ::close(logFd_);
+        logFd_ = -1;
+    }
+}
+
+void BookShard::destroy()
+{
+    close();
+    std::remove(dataFile_.c_str());
+    std::remove(logFile_.c_str());
+}
+
+size_t BookShard::size() const
+{
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return books_.size();
+}
+
+BookPtr BookShard::find(long long id) const
+{
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto it = books_.find(id);
+    return it == books_.end() ? nullptr : it->second;
+}
+
+std::vector<BookPtr> BookShard::all() const
+{
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    std::vector<BookPtr> books;
+    books.reserve(books_.size());
+    for (const auto& entry : books_)
+    {
+        books.push_back(entry.second);
+    }
+    return books;
+}
+
+// Store new or replacement records; each must carry a numeric bookID.
+// Mutations reach memory before they are queued for commit, so a compaction
+// running on the committer never snapshots state older than its log.
+void BookShard::put(std::vector<BookPtr> books, CommitCallback done)
+{
+    std::string records;
+    for (const auto& book : books)
+    {
+        records += "P," + book->toCSV() + "\n";
+    }
+
+    {
+        std::lock_guard<std::mutex> writer(writeMutex_);
+        if (!failed_)
+        {
+            {
+                std::unique_lock<std::shared_mutex> lock(mutex_);
+                for (const auto& book : books)
+                {
+                    long long id;
+                    if (bookIdOf(*book, id))
+                    {
+                        setBook(id, book);
+                    }
+                }
+            }
+            enqueueCommit(std::move(records), books.size(), std::move(done));
+            return;
+        }
+    }
+    done(writeRefused());
+}
+
+bool BookShard::update(long long id, const std::function<void(Book&)>& patch, CommitCallback done)
+{
+    std::exception_ptr error;
+    {
+        std::lock_guard<std::mutex> writer(writeMutex_);
+
+        // Only writers modify books_ and we hold the writer lock, so the record
+        // can be read and patched without blocking readers
+        if (failed_)
+        {
+            error = writeRefused();
+        }
+        else if (BookPtr current = find(id))
+        {
+            auto book = std::make_shared<Book>(*current);
+            patch(*book);
+            book->bookID = current->bookID;
+            std::string record = "P," + book->toCSV() + "\n";
+            {
+                std::unique_lock<std::shared_mutex> lock(mutex_);
+                setBook(id, std::move(book));
+            }
+            enqueueCommit(std::move(record), 1, std::move(done));
+            return true;
+        }
+    }
+    done(error);
+    return false;
+}
+
+bool BookShard::upsert(long long id, const std::function<void(Book&)>& patch, CommitCallback done)
+{
+    {
+        std::lock_guard<std::mutex> writer(writeMutex_);
+        if (!failed_)
+        {
+            BookPtr current = find(id);
+            auto book = current ? std::make_shared<Book>(*current) : std::make_shared<Book>();
+            patch(*book);
+            book->bookID = std::to_string(id);
+            std::string record = "P," + book->toCSV() + "\n";
+            {
+                std::unique_lock<std::shared_mutex> lock(mutex_);
+                setBook(id, std::move(book));
+            }
+            enqueueCommit(std::move(record), 1, std::move(done));
+            return !current;
+        }
+    }
+    done(writeRefused());
+    return false;
+}
+
+bool BookShard::remove(long long id, CommitCallback done)
+{
+    std::exception_ptr error;
+    {
+        std::lock_guard<std::mutex> writer(writeMutex_);
+        if (failed_)
+        {
+            error = writeRefused();
+        }
+        else if (find(id))
+        {
+            {
+                std::unique_lock<std::shared_mutex> lock(mutex_);
+                eraseBook(id);
+            }
+            enqueueCommit("D," + std::to_string(id) + "\n", 1, std::move(done));
+            return true;
+        }
+    }
+    done(error);
+    return false;
+}
+
+// The error handed to writers of a shard that could not roll back a failed commit
+std::exception_ptr BookShard::writeRefused() const
+{
+    return std::make_exception_ptr(StorageError("Shard " + dataFile_ + " is read-only after a failed commit"));
+}
+
+// Queue log records for the committer; the caller holds writeMutex_, so the
+// queue is in the same order as the changes to memory
+void BookShard::enqueueCommit(std::string records, size_t count, CommitCallback done)
+{
+    {
+        std::lock_guard<std::mutex> lock(commitMutex_);
+        pending_.push_back({std::move(records), count, std::move(done)});
+    }
+    commitReady_.notify_one();
+}
+
+// Group commit: write every queued mutation with one write and one fdatasync,
+// then acknowledge them all. Runs until close() and drains the queue first.
+void BookShard::commitLoop()
+{
+    while (true)
+    {
+        std::vector<PendingCommit> batch;
+        {
+            std::unique_lock<std::mutex> lock(commitMutex_);
+            commitReady_.wait(lock, [this]() { return stopping_ || !pending_.empty(); });
+            if (pending_.empty())
+            {
+                return;
+            }
+
+            // Give concurrent writers a short window to join the batch
+            if (pending_.size() < options_.commitMaxBatch && !stopping_ && options_.commitWindow.count() > 0)
+            {
+                commitReady_.wait_for(lock, options_.commitWindow, [this]() {
+                    return stopping_ || pending_.size() >= options_.commitMaxBatch;
+                });
+            }
+
+            size_t count = std::min(pending_.size(), options_.commitMaxBatch);
+            batch.assign(std::make_move_iterator(pending_.begin()), std::make_move_iterator(pending_.begin() + count));
+            pending_.erase(pending_.begin(), pending_.begin() + count);
+        }
+
+        try
+        {
+            writeBatch(batch);
+        }
+        catch (const std::exception& e)
+        {
+            LOG_ERROR << "Group commit of " << batch.size() << " mutations to " << logFile_ << " failed: " << e.what();
+            auto error = std::current_exception();
+            {
+                std::lock_guard<std::mutex> writer(writeMutex_);
+                rollBack(batch);
+            }
+            for (auto& commit : batch)
+            {
+                commit.done(error);
+            }
+            continue;
+        }
+
+        for (auto& commit : batch)
+        {
+            commit.done(nullptr);
+        }
+        if (logRecords_ >= options_.compactionRecords)
+        {
+            compactCommitted();
+        }
+    }
+}
+
+// Append a batch to the log with one write and one fdatasync; the log counters
+// only move once it is synced
+void BookShard::writeBatch(const std::vector<PendingCommit>& batch)
+{
+    std::string records;
+    size_t recordCount = 0;
+    for (const auto& commit : batch)
+    {
+        records += commit.records;
+        recordCount += commit.count;
+    }
+    writeAll(logFd_, records, logFile_);
+    if (::fdatasync(logFd_) != 0)
+    {
+        throw StorageError("Unable to sync mutation log " + logFile_);
+    }
+    logRecords_ += recordCount;
+    logLength_ += records.size();
+}
+
+// Undo a failed commit; the caller holds writeMutex_ and fails the batch once
+// it is released. Part of the batch may have reached the log and all of it is
+// in memory, along with any mutations queued behind it, which join the batch.
+// The log is cut back to its last synced length, dropping any torn record, and
+// the shard is reloaded from disk, so memory matches the log again.
+void BookShard::rollBack(std::vector<PendingCommit>& batch)
+{
+    {
+        std::lock_guard<std::mutex> lock(commitMutex_);
+        std::move(pending_.begin(), pending_.end(), std::back_inserter(batch));
+        pending_.clear();
+    }
+    try
+    {
+        if (::ftruncate(logFd_, static_cast<off_t>(logLength_)) != 0 || ::fsync(logFd_) != 0)
+        {
+            throw StorageError("Unable to roll back mutation log " + logFile_);
+        }
+        load();
+    }
+    catch (const std::exception& e)
+    {
+        // Memory may still hold writes that are not durable, so stop
+        // taking writes rather than let a compaction persist them
+        failed_ = true;
+        LOG_ERROR << e.what() << "; " << dataFile_ << " no longer accepts writes";
+    }
+}
+
+// Compact on the committer thread. Memory runs ahead of the log by whatever is
+// still queued, so writers are held off while the queue is committed and the
+// snapshot taken; the snapshot then holds exactly what the log does. Files are
+// written after writers resume: only this thread touches the log meanwhile.
+void BookShard::compactCommitted()
+{
+    std::vector<PendingCommit> batch;
+    std::string snapshot;
+    std::exception_ptr error;
+    {
+        std::lock_guard<std::mutex> writer(writeMutex_);
+        if (failed_)
+        {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(commitMutex_);
+            batch.assign(std::make_move_iterator(pending_.begin()), std::make_move_iterator(pending_.end()));
+            pending_.clear();
+        }
+        try
+        {
+            if (!batch.empty())
+            {
+                writeBatch(batch);
+            }
+            snapshot = snapshotText();
+        }
+        catch (const std::exception& e)
+        {
+            LOG_ERROR << "Commit of " << batch.size() << " mutations to " << logFile_ << " failed: " << e.what();
+            error = std::current_exception();
+            rollBack(batch);
+        }
+    }
+    for (auto& commit : batch)
+    {
+        commit.done(error);
+    }
+    if (error)
+    {
+        return;
+    }
+
+    // Everything in the snapshot is already durable in the log, so a failed
+    // compaction is only logged and retried after the next commit
+    try
+    {
+        compact(snapshot);
+    }
+    catch (const std::exception& e)
+    {
+        LOG_ERROR << e.what();
+    }
+}
+
+// The shard's rows as a CSV snapshot
+std::string BookShard::snapshotText() const
+{
+    std::string snapshot = CSV_HEADER;
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    for (const auto& entry : books_)
+    {
+        snapshot += entry.second->toCSV();
+        snapshot += '\n';
+    }
+    return snapshot;
+}
+
+// Replace the snapshot and empty the log; the snapshot must hold everything
+// the log does. It is synced and renamed into place before the log is
+// truncated, so a crash in between only replays records already in it.
+void BookShard::compact(const std::string& snapshot)
+{
+    std::string tmpFile = dataFile_ + ".tmp";
+    int fd = ::open(tmpFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        throw StorageError("Unable to open shard snapshot for writing: " + tmpFile);
+    }
+    try
+    {
+        writeAll(fd, snapshot, tmpFile);
+        if (::fsync(fd) != 0)
+        {
+            throw StorageError("Unable to sync shard snapshot " + tmpFile);
+        }
+    }
+    catch (...)
+    {
+        ::close(fd);
+        throw;
+    }
+    ::close(fd);
+
+    // Created before the rename so the directory sync below also makes a new
+    // log's entry durable
+    if (logFd_ < 0)
+    {
+        logFd_ = ::open(logFile_.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+        if (logFd_ < 0)
+        {
+            throw StorageError("Unable to open mutation log " + logFile_);
+        }
+    }
+    if (std::rename(tmpFile.c_str(), dataFile_.c_str()) != 0)
+    {
+        throw StorageError("Unable to replace shard snapshot " + dataFile_);
+    }
+    syncDirectory(dataFile_);
+
+    if (::ftruncate(logFd_, 0) != 0)
+    {
+        throw StorageError("Unable to truncate mutation log " + logFile_);
+    }
+    logRecords_ = 0;
+    logLength_ = 0;
+    if (::fsync(logFd_) != 0)
+    {
+        throw StorageError("Unable to sync mutation log " + logFile_);
+    }
+}
+
+void BookStore::initAndStart(const Json::Value& config)
+{
+    dataDir_ = config.get("data_dir", "./").asString();
+    size_t shardCount = std::max(1u, config.get("shards", 8).asUInt());
+    ShardOptions options;
+    options.compactionRecords = std::max<Json::UInt64>(1, config.get("log_compaction_records", 10000).asUInt64());
+    options.commitWindow = std::chrono::microseconds(config.get("commit_window_us", 200).asUInt());
+    options.commitMaxBatch = std::max(1u, config.get("commit_max_batch", 512).asUInt());
+    std::filesystem::create_directories(dataDir_);
+
+    // Shard files are named after the shard count, so a re-partition never
+    // overwrites the layout it is reading from
+    size_t previousCount = previousShardCount();
+
+    for (size_t i = 0; i < shardCount; ++i)
+    {
+        std::string prefix = shardPrefix(shardCount, i);
+        shards_.push_back(std::make_unique<BookShard>(prefix + ".csv", prefix + ".log", options));
+    }
+
+    if (previousCount == shardCount)
+    {
+        for (auto& shard : shards_)
+        {
+            shard->load();
+            shard->open();
+        }
+    }
+    else
+    {
+        std::vector<std::unique_ptr<BookShard>> previousShards;
+        std::vector<BookPtr> books;
+        if (previousCount == 0)
+        {
+            books = loadLegacyCatalog(config.get("seed_file", "books.csv").asString());
+        }
+        else
+        {
+            for (size_t i = 0; i < previousCount; ++i)
+            {
+                std::string prefix = shardPrefix(previousCount, i);
+                previousShards.push_back(std::make_unique<BookShard>(prefix + ".csv", prefix + ".log", options));
+                previousShards.back()->load();
+                auto shardBooks = previousShards.back()->all();
+                books.insert(books.end(), shardBooks.begin(), shardBooks.end());
+            }
+        }
+
+        std::vector<std::vector<BookPtr>> partitions(shardCount);
+        for (auto& book : books)
+        {
+            long long id;
+            if (bookIdOf(*book, id))
+            {
+                partitions[shardFor(id)].push_back(std::move(book));
+            }
+        }
+        for (size_t i = 0; i < shardCount; ++i)
+        {
+            shards_[i]->assign(std::move(partitions[i]));
+            shards_[i]->open();
+        }
+
+        // The old shards are only removed once the manifest naming the new
+        // ones is durable
+        writeManifest(shardCount);
+        for (auto& shard : previousShards)
+        {
+            shard->destroy();
+        }
+        LOG_INFO << "Partitioned " << size() << " books into " << shardCount << " shards";
+    }
+
+    idAllocator_ = std::make_unique<BookIdAllocator>((std::filesystem::path(dataDir_) / SEQ_FILE).string());
+    idAllocator_->initialize([this]() {
+        long long maxID = 0;
+        for (const auto& shard : shards_)
+        {
+            std::shared_lock<std::shared_mutex> lock(shard->mutex_);
+            if (!shard->books_.empty())
+            {
+                maxID = std::max(maxID, shard->books_.rbegin()->first);
+            }
+        }
+        return maxID;
+    });
+}
+
+void BookStore::shutdown()
+{
+    shards_.clear();
+}
+
+size_t BookStore::size() const
+{
+    size_t total = 0;
+    for (const auto& shard : shards_)
+    {
+        total += shard->size();
+    }
+    return total;
+}
+
+uint64_t BookStore::version() const
+{
+    return version_.load();
+}
+
+// Merge the shards back into bookID order
+std::vector<BookPtr> BookStore::list(int limit, int offset) const
+{
+    std::vector<std::shared_lock<std::shared_mutex>> locks;
+    locks.reserve(shards_.size());
+    for (const auto& shard : shards_)
+    {
+        locks.emplace_back(shard->mutex_);
+    }
+
+    using Cursor = std::pair<std::map<long long, BookPtr>::const_iterator, std::map<long long, BookPtr>::const_iterator>;
+    std::vector<Cursor> cursors;
+    auto later = [&cursors](size_t a, size_t b) { return cursors[a].first->first > cursors[b].first->first; };
+    std::priority_queue<size_t, std::vector<size_t>, decltype(later)> heap(later);
+    for (const auto& shard : shards_)
+    {
+        cursors.emplace_back(shard->books_.begin(), shard->books_.end());
+    }
+    for (size_t i = 0; i < cursors.size(); ++i)
+    {
+        if (cursors[i].first != cursors[i].second)
+        {
+            heap.push(i);
+        }
+    }
+
+    std::vector<BookPtr> books;
+    int skipped = 0;
+    while (!heap.empty() && (limit < 0 || static_cast<int>(books.size()) < limit))
+    {
+        size_t i = heap.top();
+        heap.pop();
+        if (skipped < offset)
+        {
+            ++skipped;
+        }
+        else
+        {
+            books.push_back(cursors[i].first->second);
+        }
+        if (++cursors[i].first != cursors[i].second)
+        {
+            heap.push(i);
+        }
+    }
+    return books;
+}
+
+BookPtr BookStore::find(long long id) const
+{
+    return shards_[shardFor(id)]->find(id);
+}
+
+std::vector<BookPtr> BookStore::booksByAuthor(const std::string& name, int limit, int offset) const
+{
+    return booksByName(&BookShard::authorIndex_, name, limit, offset);
+}
+
+std::vector<BookPtr> BookStore::booksByPublisher(const std::string& name, int limit, int offset) const
+{
+    return booksByName(&BookShard::publisherIndex_, name, limit, offset);
+}
+
+std::vector<NameCount> BookStore::authors(int limit, int offset) const
+{
+    return listNames(&BookShard::authorIndex_, limit, offset);
+}
+
+std::vector<NameCount> BookStore::publishers(int limit, int offset) const
+{
+    return listNames(&BookShard::publisherIndex_, limit, offset);
+}
+
+// Trigram pruning, then Myers verification of the surviving candidates
+BookStore::SearchResults BookStore::search(const std::string& query, bool fuzzy, int limit, int offset) const
+{
+    std::string pattern = TrigramIndex::normalize(query);
+    MyersMatcher matcher(pattern);
+    size_t maxEdits = fuzzy ? std::min<size_t>(2, pattern.size() / 4) : 0;
+
+    // Each edit destroys at most four of the pattern's trigrams, so a match
+    // shares all but 4k of them. When that leaves none, nothing can be pruned
+    // and every text is verified; Myers is cheap enough for that.
+    auto grams = TrigramIndex::trigrams(pattern);
+    bool prune = grams.size() > 4 * maxEdits;
+    size_t minShared = prune ? grams.size() - 4 * maxEdits : 0;
+
+    SearchResults results;
+    std::vector<SearchHit> hits;
+    for (const auto& shard : shards_)
+    {
+        std::shared_lock<std::shared_mutex> lock(shard->mutex_);
+        auto verify = [&](long long id, const std::string& text) {
+            size_t edits = matcher.distance(text);
+            if (edits <= maxEdits)
+            {
+                double score = pattern.empty() ? 1.0 : 1.0 - static_cast<double>(edits) / pattern.size();
+                hits.push_back({shard->books_.at(id), score});
+            }
+        };
+        if (prune)
+        {
+            auto ids = shard->searchIndex_.candidates(grams, minShared);
+            results.verified += ids.size();
+            for (long long id : ids)
+            {
+                verify(id, shard->searchIndex_.text(id));
+            }
+        }
+        else
+        {
+            const auto& texts = shard->searchIndex_.texts();
+            results.verified += texts.size();
+            for (const auto& [id, text] : texts)
+            {
+                verify(id, text);
+            }
+        }
+    }
+    results.matched = hits.size();
+
+    // Best matches first; among equals, the more widely rated book
+    auto ratings = [](const Book& book) { return std::strtoll(book.ratingsCount.c_str(), nullptr, 10); };
+    std::sort(hits.begin(), hits.end(), [&ratings](const SearchHit& a, const SearchHit& b) {
+        if (a.score != b.score)
+        {
+            return a.score > b.score;
+        }
+        long long aRatings = ratings(*a.book);
+        long long bRatings = ratings(*b.book);
+        if (aRatings != bRatings)
+        {
+            return aRatings > bRatings;
+        }
+        return std::strtoll(a.book->bookID.c_str(), nullptr, 10) < std::strtoll(b.book->bookID.c_str(), nullptr, 10);
+    });
+
+    size_t first = std::min(hits.size(), static_cast<size_t>(std::max(0, offset)));
+    size_t last = limit < 0 ? hits.size() : std::min(hits.size(), first + static_cast<size_t>(limit));
+    results.hits.assign(std::make_move_iterator(hits.begin() + first), std::make_move_iterator(hits.begin() + last));
+    return results;
+}
+
+std::string BookStore::normalizeName(const std::string& name)
+{
+    std::string key = collapseWhitespace(name);
+    for (char& c : key)
+    {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    return key;
+}
+
+// Merge the shards' posting lists for one name into bookID order; only the
+// requested page is visited, so the cost follows the result size
+std::vector<BookPtr> BookStore::booksByName(BookShard::NameIndex BookShard::*index, const std::string& name, int limit,
+                                            int offset) const
+{
+    std::string key = normalizeName(name);
+    std::vector<std::shared_lock<std::shared_mutex>> locks;
+    locks.reserve(shards_.size());
+    for (const auto& shard : shards_)
+    {
+        locks.emplace_back(shard->mutex_);
+    }
+
+    using Cursor = std::pair<std::set<long long>::const_iterator, std::set<long long>::const_iterator>;
+    std::vector<Cursor> cursors;
+    std::vector<const BookShard*> owners;
+    for (const auto& shard : shards_)
+    {
+        auto it = ((*shard).*index).find(key);
+        if (it != ((*shard).*index).end())
+        {
+            cursors.emplace_back(it->second.bookIDs.begin(), it->second.bookIDs.end());
+            owners.push_back(shard.get());
+        }
+    }
+    auto later = [&cursors](size_t a, size_t b) { return *cursors[a].first > *cursors[b].first; };
+    std::priority_queue<size_t, std::vector<size_t>, decltype(later)> heap(later);
+    for (size_t i = 0; i < cursors.size(); ++i)
+    {
+        heap.push(i);
+    }
+
+    std::vector<BookPtr> books;
+    int skipped = 0;
+    while (!heap.empty() && (limit < 0 || static_cast<int>(books.size()) < limit))
+    {
+        size_t i = heap.top();
+        heap.pop();
+        if (skipped < offset)
+        {
+            ++skipped;
+        }
+        else
+        {
+            books.push_back(owners[i]->books_.at(*cursors[i].first));
+        }
+        if (++cursors[i].first != cursors[i].second)
+        {
+            heap.push(i);
+        }
+    }
+    return books;
+}
+
+// Merge the shards' indexes into one name-ordered listing, summing the counts
+// of names that appear in several shards
+std::vector<NameCount> BookStore::listNames(BookShard::NameIndex BookShard::*index, int limit, int offset) const
+{
+    std::vector<std::shared_lock<std::shared_mutex>> locks;
+    locks.reserve(shards_.size());
+    for (const auto& shard : shards_)
+    {
+        locks.emplace_back(shard->mutex_);
+    }
+
+    using Cursor = std::pair<BookShard::NameIndex::const_iterator, BookShard::NameIndex::const_iterator>;
+    std::vector<Cursor> cursors;
+    for (const auto& shard : shards_)
+    {
+        cursors.emplace_back(((*shard).*index).begin(), ((*shard).*index).end());
+    }
+    auto later = [&cursors](size_t a, size_t b) { return cursors[a].first->first > cursors[b].first->first; };
+    std::priority_queue<size_t, std::vector<size_t>, decltype(later)> heap(later);
+    for (size_t i = 0; i < cursors.size(); ++i)
+    {
+        if (cursors[i].first != cursors[i].second)
+        {
+            heap.push(i);
+        }
+    }
+
+    std::vector<NameCount> names;
+    int skipped = 0;
+    while (!heap.empty() && (limit < 0 || static_cast<int>(names.size()) < limit))
+    {
+        // Pop every shard's entry for the smallest name
+        NameCount entry{"", 0};
+        const std::string key = cursors[heap.top()].first->first;
+        while (!heap.empty() && cursors[heap.top()].first->first == key)
+        {
+            size_t i = heap.top();
+            heap.pop();
+            if (entry.name.empty())
+            {
+                entry.name = cursors[i].first->second.name;
+            }
+            entry.bookCount += cursors[i].first->second.bookIDs.size();
+            if (++cursors[i].first != cursors[i].second)
+            {
+                heap.push(i);
+            }
+        }
+
+        if (skipped < offset)
+        {
+            ++skipped;
+        }
+        else
+        {
+            names.push_back(std::move(entry));
+        }
+    }
+    return names;
+}
+
+BookPtr BookStore::insert(Book book, CommitCallback done)
+{
+    long long id = idAllocator_->next();
+    book.bookID = std::to_string(id);
+    BookPtr stored = std::make_shared<const Book>(std::move(book));
+    shards_[shardFor(id)]->put({stored}, std::move(done));
+    version_++;
+    return stored;
+}
+
+// Reserve one block of IDs for the batch and write each shard's part at once;
+// done fires when every shard has committed its part
+std::vector<BookPtr> BookStore::insertBatch(std::vector<Book> books, CommitCallback done)
+{
+    if (books.empty())
+    {
+        done(nullptr);
+        return {};
+    }
+
+    long long firstID = idAllocator_->reserve(books.size());
+    std::vector<BookPtr> stored;
+    std::vector<std::vector<BookPtr>> partitions(shards_.size());
+    std::vector<std::vector<long long>> partitionIDs(shards_.size());
+    for (size_t i = 0; i < books.size(); ++i)
+    {
+        long long id = firstID + static_cast<long long>(i);
+        books[i].bookID = std::to_string(id);
+        stored.push_back(std::make_shared<const Book>(std::move(books[i])));
+        partitions[shardFor(id)].push_back(stored.back());
+        partitionIDs[shardFor(id)].push_back(id);
+    }
+
+    auto batch = std::make_shared<BatchCommit>();
+    batch->remaining =
+        std::count_if(partitions.begin(), partitions.end(), [](const auto& part) { return !part.empty(); });
+    batch->done = std::move(done);
+    for (size_t i = 0; i < shards_.size(); ++i)
+    {
+        if (!partitions[i].empty())
+        {
+            shards_[i]->put(std::move(partitions[i]), commitPart(batch, std::move(partitionIDs[i])));
+        }
+    }
+    version_ += stored.size();
+    return stored;
+}
+
+bool BookStore::update(long long id, const std::function<void(Book&)>& patch, CommitCallback done)
+{
+    if (!shards_[shardFor(id)]->update(id, patch, std::move(done)))
+    {
+        return false;
+    }
+    version_++;
+    return true;
+}
+
+bool BookStore::upsert(long long id, const std::function<void(Book&)>& patch, CommitCallback done)
+{
+    // Try the patch on a scratch book first, so a rejected one neither moves
+    // the sequence nor reaches the shard; then keep the allocator ahead of
+    // client-chosen IDs before the book becomes visible
+    Book scratch;
+    patch(scratch);
+    idAllocator_->observe(id);
+    bool created = shards_[shardFor(id)]->upsert(id, patch, std::move(done));
+    version_++;
+    return created;
+}
+
+bool BookStore::remove(long long id, CommitCallback done)
+{
+    if (!shards_[shardFor(id)]->remove(id, std::move(done)))
+    {
+        return false;
+    }
+    version_++;
+    return true;
+}
+
+// splitmix64 finalizer, so sequential IDs spread evenly over the shards
+size_t BookStore::shardFor(long long id) const
+{
+    uint64_t x = static_cast<uint64_t>(id);
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x % shards_.size();
+}
+
+// Path of a shard's files, without extension, e.g. books-8.3 for shard 3 of 8
+std::string BookStore::shardPrefix(size_t shardCount, size_t index) const
+{
+    return (std::filesystem::path(dataDir_) / "books-").string() + std::to_string(shardCount) + "." + std::to_string(index);
+}
+
+// The shard count the data directory was last partitioned into, or 0 on first
+// start. A missing or empty manifest with shard files beside it was lost in a
+// crash: the one complete set of shard files names the layout and the manifest
+// is rewritten, since re-importing the seed would discard every mutation.
+size_t BookStore::previousShardCount() const
+{
+    std::string manifestFile = (std::filesystem::path(dataDir_) / MANIFEST_FILE).string();
+    auto lines = readCompleteLines(manifestFile);
+    if (!lines.empty())
+    {
+        char* end;
+        unsigned long long count = std::strtoull(lines[0].c_str(), &end, 10);
+        if (lines[0].empty() || *end != '\0' || count == 0)
+        {
+            throw StorageError("Corrupt shard manifest " + manifestFile);
+        }
+        return count;
+    }
+
+    // Snapshot indexes present for each shard count, from books-<count>.<index>.csv
+    std::map<size_t, std::set<size_t>> layouts;
+    for (const auto& entry : std::filesystem::directory_iterator(dataDir_))
+    {
+        std::string name = entry.path().filename().string();
+        size_t count;
+        size_t index;
+        int length = 0;
+        if (std::sscanf(name.c_str(), "books-%zu.%zu.csv%n", &count, &index, &length) == 2 &&
+            static_cast<size_t>(length) == name.size() && index < count &&
+            std::filesystem::path(shardPrefix(count, index) + ".csv").filename() == name)
+        {
+            layouts[count].insert(index);
+        }
+    }
+    if (layouts.empty())
+    {
+        return 0;
+    }
+
+    size_t recovered = 0;
+    for (const auto& [count, indexes] : layouts)
+    {
+        if (indexes.size() == count)
+        {
+            if (recovered != 0)
+            {
+                throw StorageError("Shard manifest " + manifestFile + " is missing and " + dataDir_ +
+                                   " holds more than one complete set of shards");
+            }
+            recovered = count;
+        }
+    }
+    if (recovered == 0)
+    {
+        throw StorageError("Shard manifest " + manifestFile + " is missing and the shard files in " + dataDir_ +
+                           " are incomplete");
+    }
+    LOG_WARN << "Shard manifest " << manifestFile << " is missing; recovered " << recovered << " shards from "
+             << dataDir_;
+    writeManifest(recovered);
+    return recovered;
+}
+
+// Durably record the shard count: the manifest is synced, renamed into place
+// and its directory synced before it returns
+void BookStore::writeManifest(size_t shardCount) const
+{
+    std::string manifestFile = (std::filesystem::path(dataDir_) / MANIFEST_FILE).string();
+    std::string tmpFile = manifestFile + ".tmp";
+    int fd = ::open(tmpFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        throw StorageError("Unable to open shard manifest for writing: " + tmpFile);
+    }
+    try
+    {
+        writeAll(fd, std::to_string(shardCount) + "\n", tmpFile);
+        if (::fsync(fd) != 0)
+        {
+            throw StorageError("Unable to sync shard manifest " + tmpFile);
+        }
+    }
+    catch (...)
+    {
+        ::close(fd);
+        throw;
+    }
+    ::close(fd);
+    if (std::rename(tmpFile.c_str(), manifestFile.c_str()) != 0)
+    {
+        throw StorageError("Unable to update shard manifest " + manifestFile);
+    }
+    syncDirectory(manifestFile);
+}
+
+// Read the single-file catalog the store is seeded from on first start
+std::vector<BookPtr> BookStore::loadLegacyCatalog(const std::string& seedFile) const
+{
+    std::vector<BookPtr> books;
+    auto rows = readCompleteLines((std::filesystem::path(dataDir_) / seedFile).string());
+    for (size_t i = 1; i < rows.size(); ++i)  // Skip the header line
+    {
+        auto book = std::make_shared<const Book>(Book::fromCSV(rows[i]));
+        long long id;
+        if (bookIdOf(*book, id))
+        {
+            books.push_back(std::move(book));
+        }
+        else
+        {
+            LOG_WARN << "Skipping catalog row without a numeric bookID: " << rows[i];
+        }
+    }
+    return books;
+}
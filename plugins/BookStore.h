@@ -0,0 +1,268 @@
+#pragma once
+#include <drogon/plugins/Plugin.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "BookIdAllocator.h"
+#include "StorageError.h"
+#include "TextSearch.h"
+
+struct Book {
+    std::string bookID;
+    std::string title;
+    std::string authors;
+    std::string avgRating;
+    std::string isbn;
+    std::string isbn13;
+    std::string languageCode;
+    std::string numPages;
+    std::string ratingsCount;
+    std::string textReviewsCount;
+    std::string publicationDate;
+    std::string publisher;
+
+    static std::string escapeCSV(const std::string& str);
+    std::string toCSV() const;
+    Json::Value toJson() const;
+    static Book fromCSV(const std::string& line);
+
+    // Individual contributors from the '/'-separated authors field
+    std::vector<std::string> authorNames() const;
+};
+
+// Books are immutable once stored; updates replace the whole record, so
+// readers can keep using the pointers they collected without holding locks.
+using BookPtr = std::shared_ptr<const Book>;
+
+// Invoked once a mutation is durable on disk, or with the error that kept it
+// from getting there. Mutations that change nothing invoke it immediately.
+using CommitCallback = std::function<void(std::exception_ptr)>;
+
+// An author or publisher and the number of books listed under it
+struct NameCount
+{
+    std::string name;
+    size_t bookCount;
+};
+
+// A search result and its similarity to the query, 1.0 for an exact match
+struct SearchHit
+{
+    BookPtr book;
+    double score;
+};
+
+// Durability and compaction settings shared by all shards
+struct ShardOptions
+{
+    size_t compactionRecords = 10000;
+    std::chrono::microseconds commitWindow{200};
+    size_t commitMaxBatch = 512;
+};
+
+// One hash partition of the catalog.
+//
+// A shard keeps its rows in memory, keyed by numeric bookID, and persists them
+// as a CSV snapshot plus an append-only mutation log. Mutations are applied in
+// memory under the shard's writer lock and queued for the shard's committer
+// thread, which group-commits them: it waits up to the commit window for
+// concurrent mutations to join a batch, writes the batch with one write and
+// one fdatasync, and only then fires the batch's commit callbacks. The log is
+// folded into a fresh snapshot once it grows past the compaction threshold.
+//
+// If a commit fails, the log is cut back to its last synced length and the
+// shard is reloaded from disk, so a mutation reported as failed is never
+// visible or snapshotted; mutations queued behind it fail with it. A shard
+// that cannot roll back refuses further writes until restart.
+//
+// Each shard also indexes its books by author and publisher: posting lists of
+// bookIDs keyed by normalized name, maintained under the same lock as books_.
+// A trigram index over each book's title and authors serves text search.
+class BookShard
+{
+public:
+    struct Posting
+    {
+        std::string name;  // Spelling first seen, for display
+        std::set<long long> bookIDs;
+    };
+    using NameIndex = std::map<std::string, Posting>;
+
+    BookShard(std::string dataFile, std::string logFile, const ShardOptions& options);
+    ~BookShard();
+    BookShard(const BookShard&) = delete;
+    BookShard& operator=(const BookShard&) = delete;
+
+    // Rebuild the in-memory rows from the snapshot and mutation log
+    void load();
+
+    // Replace the in-memory rows; used when re-partitioning
+    void assign(std::vector<BookPtr> books);
+
+    // Write a fresh snapshot, open an empty log and start the committer
+    void open();
+
+    // Stop the committer once everything queued is durable
+    void close();
+
+    // Remove the shard's files
+    void destroy();
+
+    size_t size() const;
+    BookPtr find(long long id) const;
+    std::vector<BookPtr> all() const;
+
+    void put(std::vector<BookPtr> books, CommitCallback done);
+    bool update(long long id, const std::function<void(Book&)>& patch, CommitCallback done);
+    bool upsert(long long id, const std::function<void(Book&)>& patch, CommitCallback done);
+    bool remove(long long id, CommitCallback done);
+
+private:
+    friend class BookStore;
+
+    struct PendingCommit
+    {
+        std::string records;
+        size_t count;
+        CommitCallback done;
+    };
+
+    void applyRecord(const std::string& record);
+    void setBook(long long id, BookPtr book);
+    void eraseBook(long long id);
+    void indexBook(long long id, const Book& book);
+    void unindexBook(long long id, const Book& book);
+    void enqueueCommit(std::string records, size_t count, CommitCallback done);
+    void commitLoop();
+    void writeBatch(const std::vector<PendingCommit>& batch);
+    void rollBack(std::vector<PendingCommit>& batch);
+    std::exception_ptr writeRefused() const;
+    void compactCommitted();
+    std::string snapshotText() const;
+    void compact(const std::string& snapshot);
+
+    std::string dataFile_;
+    std::string logFile_;
+    ShardOptions options_;
+
+    // Guards books_ and the indexes; held exclusively only while a mutation is applied
+    mutable std::shared_mutex mutex_;
+    std::map<long long, BookPtr> books_;
+    NameIndex authorIndex_;
+    NameIndex publisherIndex_;
+    TrigramIndex searchIndex_;
+
+    // The shard's writer: orders mutations so the log matches memory
+    std::mutex writeMutex_;
+
+    // Commit buffer; the log itself is only touched by the committer thread
+    std::mutex commitMutex_;
+    std::condition_variable commitReady_;
+    std::deque<PendingCommit> pending_;
+    bool stopping_ = false;
+    std::thread committer_;
+    int logFd_ = -1;
+    size_t logRecords_ = 0;
+    size_t logLength_ = 0;  // Bytes of the log known to be synced
+
+    // Set under writeMutex_ when a failed commit could not be rolled back
+    bool failed_ = false;
+};
+
+// Hash-partitioned catalog store.
+//
+// Books are spread over a configurable number of shards by a hash of their
+// bookID, so writes to different shards proceed in parallel. Reads that span
+// the catalog merge the shards back into bookID order.
+//
+// Mutations return their immediate result and report durability through
+// the CommitCallback they are handed.
+//
+// Configuration (config.json, plugins section):
+//   data_dir               directory holding the shard files, "./" by default
+//   shards                 number of shards, 8 by default
+//   log_compaction_records log records per shard before it is compacted
+//   commit_window_us       how long a commit waits for more mutations to join it
+//   commit_max_batch       mutations after which a commit starts without waiting
+//   seed_file              legacy single-file catalog imported on first start
+//
+// Changing the shard count re-partitions the existing data at startup.
+class BookStore : public drogon::Plugin<BookStore>
+{
+public:
+    void initAndStart(const Json::Value& config) override;
+    void shutdown() override;
+
+    size_t size() const;
+    uint64_t version() const;
+
+    // Books in bookID order, skipping offset and returning at most limit (-1: all)
+    std::vector<BookPtr> list(int limit = -1, int offset = 0) const;
+
+    BookPtr find(long long id) const;
+
+    // Books by one author or publisher, matched on the normalized name, in bookID order
+    std::vector<BookPtr> booksByAuthor(const std::string& name, int limit = -1, int offset = 0) const;
+    std::vector<BookPtr> booksByPublisher(const std::string& name, int limit = -1, int offset = 0) const;
+
+    // Distinct authors or publishers with their book counts, in normalized name order
+    std::vector<NameCount> authors(int limit = -1, int offset = 0) const;
+    std::vector<NameCount> publishers(int limit = -1, int offset = 0) const;
+
+    struct SearchResults
+    {
+        std::vector<SearchHit> hits;  // The requested page, best matches first
+        size_t verified = 0;          // Candidates that survived trigram pruning
+        size_t matched = 0;           // Candidates within the edit bound
+    };
+
+    // Books whose title or authors contain the query, matched from the start
+    // of a word. Fuzzy searches allow one edit per four query characters, at
+    // most two; swapping adjacent characters counts as one edit.
+    SearchResults search(const std::string& query, bool fuzzy, int limit, int offset) const;
+
+    // Index key for a name: whitespace collapsed and ASCII letters lowercased
+    static std::string normalizeName(const std::string& name);
+
+    // Assign fresh bookIDs and store the books; returns the stored records.
+    // A batch spans shards that commit separately: if only some of them fail,
+    // the error passed to done names the IDs that were stored.
+    BookPtr insert(Book book, CommitCallback done);
+    std::vector<BookPtr> insertBatch(std::vector<Book> books, CommitCallback done);
+
+    // Patch an existing book; false if there is none with that ID
+    bool update(long long id, const std::function<void(Book&)>& patch, CommitCallback done);
+
+    // Patch a book, creating it first if needed; true if it was created. The
+    // patch is first tried on an empty book, so one that throws changes nothing.
+    bool upsert(long long id, const std::function<void(Book&)>& patch, CommitCallback done);
+
+    // Delete a book; false if there is none with that ID
+    bool remove(long long id, CommitCallback done);
+
+private:
+    size_t shardFor(long long id) const;
+    std::string shardPrefix(size_t shardCount, size_t index) const;
+    size_t previousShardCount() const;
+    void writeManifest(size_t shardCount) const;
+    std::vector<BookPtr> loadLegacyCatalog(const std::string& seedFile) const;
+    std::vector<BookPtr> booksByName(BookShard::NameIndex BookShard::*index, const std::string& name, int limit,
+                                     int offset) const;
+    std::vector<NameCount> listNames(BookShard::NameIndex BookShard::*index, int limit, int offset) const;
+
+    std::string dataDir_;
+    std::vector<std::unique_ptr<BookShard>> shards_;
+    std::unique_ptr<BookIdAllocator> idAllocator_;
+    std::atomic<uint64_t> version_{0};
+};
@@ -0,0 +1,10 @@
+#pragma once
+#include <stdexcept>
+
+// A failure to read or write the data directory, as opposed to a bad request:
+// handlers report it as a server error
+class StorageError : public std::runtime_error
+{
+public:
+    using std::runtime_error::runtime_error;
+};
@@ -0,0 +1,80 @@
+#include "StoragePool.h"
+#include <algorithm>
+
+BoundedPool::BoundedPool(std::string name, size_t threads, size_t maxQueued)
+    : name_(std::move(name)), maxQueued_(maxQueued)
+{
+    for (size_t i = 0; i < threads; ++i)
+    {
+        workers_.emplace_back([this]() { workerLoop(); });
+    }
+}
+
+// Finish the queued jobs, then stop the workers
+BoundedPool::~BoundedPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    ready_.notify_all();
+    for (auto& worker : workers_)
+    {
+        worker.join();
+    }
+}
+
+bool BoundedPool::submit(std::function<void()> job)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_ || jobs_.size() >= maxQueued_)
+        {
+            return false;
+        }
+        jobs_.push_back(std::move(job));
+    }
+    ready_.notify_one();
+    return true;
+}
+
+size_t BoundedPool::queued() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return jobs_.size();
+}
+
+void BoundedPool::workerLoop()
+{
+    while (true)
+    {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            ready_.wait(lock, [this]() { return stopping_ || !jobs_.empty(); });
+            if (jobs_.empty())
+            {
+                return;
+            }
+            job = std::move(jobs_.front());
+            jobs_.pop_front();
+        }
+        job();
+    }
+}
+
+void StoragePool::initAndStart(const Json::Value& config)
+{
+    size_t cores = std::max(1u, std::thread::hardware_concurrency());
+    size_t queueDepth = std::max(1u, config.get("queue_depth", 1024).asUInt());
+    io_ = std::make_unique<BoundedPool>("io", std::max(1u, config.get("io_threads", 4).asUInt()), queueDepth);
+    compute_ = std::make_unique<BoundedPool>(
+        "compute", std::max<Json::UInt64>(1, config.get("compute_threads", Json::UInt64(cores)).asUInt64()), queueDepth);
+    retryAfter_ = std::max(1, config.get("retry_after", 1).asInt());
+}
+
+void StoragePool::shutdown()
+{
+    io_.reset();
+    compute_.reset();
+}
@@ -0,0 +1,251 @@
+#pragma once
+#include <drogon/plugins/Plugin.h>
+#include <drogon/utils/coroutine.h>
+#include <trantor/net/EventLoop.h>
+#include <condition_variable>
+#include <atomic>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Thrown by an await on a pool whose queue is full
+class PoolOverloaded : public std::runtime_error
+{
+public:
+    using std::runtime_error::runtime_error;
+};
+
+// Fixed-size worker pool with a bounded queue.
+//
+// run() returns an awaitable: the calling coroutine is suspended while the work
+// runs on a pool thread and is resumed on the event loop it came from, so the
+// loop is free to serve other connections in the meantime. When the queue is
+// full the await throws PoolOverloaded instead of queueing without limit.
+//
+// runCommitted() is the same for work that hands a commit callback to the
+// store: the coroutine is only resumed once the work has returned and the
+// callback has fired, so responses are not sent before the write is durable.
+class BoundedPool
+{
+public:
+    BoundedPool(std::string name, size_t threads, size_t maxQueued);
+    ~BoundedPool();
+    BoundedPool(const BoundedPool&) = delete;
+    BoundedPool& operator=(const BoundedPool&) = delete;
+
+    // Queue a job; false if the queue is full
+    bool submit(std::function<void()> job);
+
+    size_t queued() const;
+
+    template <typename F>
+    class Awaiter
+    {
+    public:
+        using Result = std::invoke_result_t<F>;
+        static_assert(!std::is_void_v<Result>, "pool work must return a value");
+
+        Awaiter(BoundedPool& pool, F work) : pool_(pool), work_(std::move(work)) {}
+
+        bool await_ready() const noexcept { return false; }
+
+        bool await_suspend(std::coroutine_handle<> handle)
+        {
+            trantor::EventLoop* loop = trantor::EventLoop::getEventLoopOfCurrentThread();
+            bool queued = pool_.submit([this, handle, loop]() {
+                try
+                {
+                    result_.emplace(work_());
+                }
+                catch (...)
+                {
+                    exception_ = std::current_exception();
+                }
+                if (loop)
+                {
+                    loop->queueInLoop([handle]() { handle.resume(); });
+                }
+                else
+                {
+                    handle.resume();
+                }
+            });
+            if (!queued)
+            {
+                exception_ = std::make_exception_ptr(PoolOverloaded(pool_.name_ + " pool is overloaded"));
+            }
+            return queued;
+        }
+
+        Result await_resume()
+        {
+            if (exception_)
+            {
+                std::rethrow_exception(exception_);
+            }
+            return std::move(*result_);
+        }
+
+    private:
+        BoundedPool& pool_;
+        F work_;
+        std::optional<Result> result_;
+        std::exception_ptr exception_;
+    };
+
+    // Await work on a pool thread: auto value = co_await pool.run([] { ... });
+    template <typename F>
+    Awaiter<F> run(F work)
+    {
+        return Awaiter<F>(*this, std::move(work));
+    }
+
+    using CommitCallback = std::function<void(std::exception_ptr)>;
+
+    template <typename F>
+    class CommitAwaiter
+    {
+    public:
+        using Result = std::invoke_result_t<F, CommitCallback>;
+        static_assert(!std::is_void_v<Result>, "pool work must return a value");
+
+        CommitAwaiter(BoundedPool& pool, F work) : pool_(pool), work_(std::move(work)) {}
+
+        bool await_ready() const noexcept { return false; }
+
+        bool await_suspend(std::coroutine_handle<> handle)
+        {
+            // The callback may outlive the awaiter if the work throws after
+            // handing it on, so the rendezvous lives in shared state
+            auto state = std::make_shared<State>();
+            state->handle = handle;
+            state->loop = trantor::EventLoop::getEventLoopOfCurrentThread();
+            state_ = state;
+            bool queued = pool_.submit([this, state]() {
+                try
+                {
+                    result_.emplace(work_([state](std::exception_ptr error) { state->commit(error); }));
+                }
+                catch (...)
+                {
+                    exception_ = std::current_exception();
+                    state->commit(nullptr);
+                }
+                state->arrive();
+            });
+            if (!queued)
+            {
+                exception_ = std::make_exception_ptr(PoolOverloaded(pool_.name_ + " pool is overloaded"));
+            }
+            return queued;
+        }
+
+        Result await_resume()
+        {
+            if (exception_)
+            {
+                std::rethrow_exception(exception_);
+            }
+            if (state_->commitError)
+            {
+                std::rethrow_exception(state_->commitError);
+            }
+            return std::move(*result_);
+        }
+
+    private:
+        // Resumes the coroutine on the second of two arrivals: the work
+        // returning and the first invocation of the commit callback
+        struct State
+        {
+            std::coroutine_handle<> handle;
+            trantor::EventLoop* loop = nullptr;
+            std::atomic<int> remaining{2};
+            std::atomic<bool> committed{false};
+            std::exception_ptr commitError;
+
+            void commit(std::exception_ptr error)
+            {
+                if (committed.exchange(true))
+                {
+                    return;
+                }
+                commitError = error;
+                arrive();
+            }
+
+            void arrive()
+            {
+                if (remaining.fetch_sub(1) != 1)
+                {
+                    return;
+                }
+                if (loop)
+                {
+                    loop->queueInLoop([h = handle]() { h.resume(); });
+                }
+                else
+                {
+                    handle.resume();
+                }
+            }
+        };
+
+        BoundedPool& pool_;
+        F work_;
+        std::shared_ptr<State> state_;
+        std::optional<Result> result_;
+        std::exception_ptr exception_;
+    };
+
+    // Await work that commits through the callback it is given:
+    // auto value = co_await pool.runCommitted([](CommitCallback done) { ... });
+    template <typename F>
+    CommitAwaiter<F> runCommitted(F work)
+    {
+        return CommitAwaiter<F>(*this, std::move(work));
+    }
+
+private:
+    void workerLoop();
+
+    std::string name_;
+    size_t maxQueued_;
+    mutable std::mutex mutex_;
+    std::condition_variable ready_;
+    std::deque<std::function<void()>> jobs_;
+    std::vector<std::thread> workers_;
+    bool stopping_ = false;
+};
+
+// Dedicated pools that keep disk and CPU-heavy work off drogon's event loops.
+//
+// Configuration (config.json, plugins section):
+//   io_threads       threads for catalog mutations, 4 by default
+//   compute_threads  threads for scans and serialization, one per core by default
+//   queue_depth      jobs each pool may queue before rejecting, 1024 by default
+//   retry_after      seconds clients are told to wait when rejected, 1 by default
+class StoragePool : public drogon::Plugin<StoragePool>
+{
+public:
+    void initAndStart(const Json::Value& config) override;
+    void shutdown() override;
+
+    BoundedPool& io() { return *io_; }
+    BoundedPool& compute() { return *compute_; }
+    int retryAfter() const { return retryAfter_; }
+
+private:
+    std::unique_ptr<BoundedPool> io_;
+    std::unique_ptr<BoundedPool> compute_;
+    int retryAfter_ = 1;
+};
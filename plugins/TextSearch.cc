@@ -0,0 +1,225 @@
+#include "TextSearch.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+uint32_t packTrigram(const std::string& s, size_t pos)
+{
+    return static_cast<uint32_t>(static_cast<unsigned char>(s[pos])) << 16 |
+           static_cast<uint32_t>(static_cast<unsigned char>(s[pos + 1])) << 8 |
+           static_cast<uint32_t>(static_cast<unsigned char>(s[pos + 2]));
+}
+}  // namespace
+
+std::string TrigramIndex::normalize(const std::string& text)
+{
+    std::string normalized;
+    bool space = false;
+    for (char c : text)
+    {
+        unsigned char byte = static_cast<unsigned char>(c);
+
+        // Bytes of multi-byte UTF-8 characters are kept as word characters
+        bool wordChar = byte >= 0x80 || (byte >= '0' && byte <= '9') || (byte >= 'a' && byte <= 'z') ||
+                        (byte >= 'A' && byte <= 'Z');
+        if (!wordChar)
+        {
+            space = !normalized.empty();
+            continue;
+        }
+        if (space)
+        {
+            normalized += ' ';
+            space = false;
+        }
+        normalized += (byte >= 'A' && byte <= 'Z') ? static_cast<char>(byte - 'A' + 'a') : c;
+    }
+    return normalized;
+}
+
+std::vector<uint32_t> TrigramIndex::trigrams(const std::string& normalized)
+{
+    std::vector<uint32_t> grams;
+    for (size_t i = 0; i + 3 <= normalized.size(); ++i)
+    {
+        grams.push_back(packTrigram(normalized, i));
+    }
+    std::sort(grams.begin(), grams.end());
+    grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+    return grams;
+}
+
+void TrigramIndex::add(long long id, std::string normalized)
+{
+    remove(id);
+    for (uint32_t gram : trigrams(normalized))
+    {
+        // IDs mostly arrive in increasing order, which keeps this an append
+        auto& list = postings_[gram];
+        if (list.empty() || list.back() < id)
+        {
+            list.push_back(id);
+        }
+        else
+        {
+            auto it = std::lower_bound(list.begin(), list.end(), id);
+            if (it == list.end() || *it != id)
+            {
+                list.insert(it, id);
+            }
+        }
+    }
+    texts_[id] = std::move(normalized);
+}
+
+void TrigramIndex::remove(long long id)
+{
+    auto text = texts_.find(id);
+    if (text == texts_.end())
+    {
+        return;
+    }
+    for (uint32_t gram : trigrams(text->second))
+    {
+        auto posting = postings_.find(gram);
+        if (posting == postings_.end())
+        {
+            continue;
+        }
+        auto& list = posting->second;
+        auto it = std::lower_bound(list.begin(), list.end(), id);
+        if (it != list.end() && *it == id)
+        {
+            list.erase(it);
+        }
+        if (list.empty())
+        {
+            postings_.erase(posting);
+        }
+    }
+    texts_.erase(text);
+}
+
+void TrigramIndex::clear()
+{
+    postings_.clear();
+    texts_.clear();
+}
+
+std::vector<long long> TrigramIndex::candidates(const std::vector<uint32_t>& trigrams, size_t minShared) const
+{
+    minShared = std::max<size_t>(1, minShared);
+    std::vector<const std::vector<long long>*> lists;
+    for (uint32_t gram : trigrams)
+    {
+        auto posting = postings_.find(gram);
+        if (posting != postings_.end())
+        {
+            lists.push_back(&posting->second);
+        }
+    }
+    if (lists.size() < minShared)
+    {
+        return {};
+    }
+    std::sort(lists.begin(), lists.end(), [](const auto* a, const auto* b) { return a->size() < b->size(); });
+
+    // A text missing from all of the rarest lists.size() - minShared + 1 lists
+    // can share at most minShared - 1 trigrams, so only those lists are scanned
+    size_t scanned = lists.size() - minShared + 1;
+    std::unordered_map<long long, size_t> counts;
+    for (size_t i = 0; i < scanned; ++i)
+    {
+        for (long long id : *lists[i])
+        {
+            ++counts[id];
+        }
+    }
+
+    std::vector<std::pair<long long, size_t>> survivors(counts.begin(), counts.end());
+    for (size_t i = scanned; i < lists.size(); ++i)
+    {
+        size_t remaining = lists.size() - i;
+        size_t kept = 0;
+        for (auto& candidate : survivors)
+        {
+            if (candidate.second + remaining < minShared)
+            {
+                continue;
+            }
+            if (std::binary_search(lists[i]->begin(), lists[i]->end(), candidate.first))
+            {
+                ++candidate.second;
+            }
+            survivors[kept++] = candidate;
+        }
+        survivors.resize(kept);
+    }
+
+    std::vector<long long> ids;
+    for (const auto& candidate : survivors)
+    {
+        if (candidate.second >= minShared)
+        {
+            ids.push_back(candidate.first);
+        }
+    }
+    return ids;
+}
+
+MyersMatcher::MyersMatcher(const std::string& pattern) : size_(pattern.size())
+{
+    if (size_ > MAX_PATTERN)
+    {
+        throw std::invalid_argument("Search query is limited to " + std::to_string(MAX_PATTERN) + " characters");
+    }
+    for (size_t i = 0; i < size_; ++i)
+    {
+        peq_[static_cast<unsigned char>(pattern[i])] |= uint64_t(1) << i;
+    }
+}
+
+// Myers (1999) in the formulation of Hyyrö (2003), with his extension for
+// optimal string alignment: swapping two adjacent characters costs one edit,
+// the most common typo. Pv/Mv hold the vertical +1/-1 deltas of the current
+// DP column and score tracks its last cell. The horizontal delta is not
+// shifted in at row 0, so a match may start anywhere in the text.
+size_t MyersMatcher::distance(const std::string& text) const
+{
+    if (size_ == 0)
+    {
+        return 0;
+    }
+
+    uint64_t pv = ~uint64_t(0);
+    uint64_t mv = 0;
+    uint64_t d0 = 0;
+    uint64_t previousEq = 0;
+    uint64_t last = uint64_t(1) << (size_ - 1);
+    size_t score = size_;
+    size_t best = size_;
+    for (char c : text)
+    {
+        uint64_t eq = peq_[static_cast<unsigned char>(c)];
+        uint64_t transposed = ((~d0 & eq) << 1) & previousEq;
+        d0 = (((eq & pv) + pv) ^ pv) | eq | mv | transposed;
+        uint64_t ph = mv | ~(d0 | pv);
+        uint64_t mh = pv & d0;
+        if (ph & last)
+        {
+            ++score;
+        }
+        else if (mh & last)
+        {
+            --score;
+        }
+        ph <<= 1;
+        mh <<= 1;
+        pv = mh | ~(d0 | ph);
+        mv = ph & d0;
+        previousEq = eq;
+        best = std::min(best, score);
+    }
+    return best;
+}
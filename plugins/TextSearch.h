@@ -0,0 +1,67 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Trigram index over short texts, used to find fuzzy-search candidates.
+//
+// Texts are normalized (ASCII lowercased, punctuation folded to spaces) and
+// every three-byte substring, spaces included, is a trigram. Each trigram maps
+// to a sorted posting list of the IDs whose text contains it. A substring of
+// a text within k edits of a query shares at least |T| - 4k of the query's
+// trigrams T: a substitution or deletion touches at most three of them, an
+// insertion two and an adjacent transposition four. candidates() uses that
+// bound to prune before verification.
+class TrigramIndex
+{
+public:
+    // Lowercase ASCII letters, fold other ASCII punctuation to single spaces
+    static std::string normalize(const std::string& text);
+
+    // Distinct trigrams of a normalized text, sorted
+    static std::vector<uint32_t> trigrams(const std::string& normalized);
+
+    // Index a normalized text under id, replacing any text it had
+    void add(long long id, std::string normalized);
+    void remove(long long id);
+    void clear();
+
+    // The normalized text indexed under id; the id must be present
+    const std::string& text(long long id) const { return texts_.at(id); }
+
+    // Every indexed text by id, for queries too short to prune
+    const std::unordered_map<long long, std::string>& texts() const { return texts_; }
+
+    // IDs whose texts share at least minShared of the given trigrams. Only the
+    // rarest lists that any such text must appear in are scanned; the others
+    // are probed for the surviving candidates.
+    std::vector<long long> candidates(const std::vector<uint32_t>& trigrams, size_t minShared) const;
+
+private:
+    std::unordered_map<uint32_t, std::vector<long long>> postings_;
+    std::unordered_map<long long, std::string> texts_;
+};
+
+// Approximate substring matching with Myers' bit-parallel algorithm.
+//
+// The pattern, at most 64 bytes, is preprocessed once into per-byte match
+// masks; distance() then runs in one pass over the text with a handful of
+// word operations per byte, independent of the error bound. Distances are
+// optimal string alignment: an adjacent transposition is a single edit.
+class MyersMatcher
+{
+public:
+    static constexpr size_t MAX_PATTERN = 64;
+
+    explicit MyersMatcher(const std::string& pattern);
+
+    size_t patternSize() const { return size_; }
+
+    // Fewest edits turning the pattern into any substring of text
+    size_t distance(const std::string& text) const;
+
+private:
+    uint64_t peq_[256] = {};
+    size_t size_;
+};
@@ -0,0 +1,75 @@
+#include <drogon/drogon_test.h>
+#include <algorithm>
+#include <filesystem>
+#include <limits>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "TestSupport.h"
+
+DROGON_TEST(IdAllocatorSequence)
+{
+    auto dir = scratchDir("id-allocator");
+    std::string seqFile = (dir / "books.seq").string();
+    long long last;
+    {
+        BookIdAllocator allocator(seqFile);
+        allocator.initialize([]() { return 100LL; });
+        CHECK(allocator.next() == 101);
+        CHECK(allocator.reserve(10) == 102);
+        CHECK(allocator.next() == 112);
+
+        // Client-chosen IDs move the sequence past them, within bounds
+        allocator.observe(50);
+        CHECK(allocator.next() == 113);
+        allocator.observe(500);
+        CHECK(allocator.next() == 501);
+        CHECK_THROWS_AS(allocator.observe(502 + BookIdAllocator::MAX_ID_GAP), std::invalid_argument);
+        CHECK_THROWS_AS(allocator.observe(BookIdAllocator::MAX_ID + 1), std::invalid_argument);
+        CHECK_THROWS_AS(allocator.observe(std::numeric_limits<long long>::max()), std::invalid_argument);
+
+        std::vector<std::vector<long long>> allocated(4);
+        std::vector<std::thread> threads;
+        for (auto& ids : allocated)
+        {
+            threads.emplace_back([&allocator, &ids]() {
+                for (int i = 0; i < 1000; ++i)
+                {
+                    ids.push_back(allocator.next());
+                }
+            });
+        }
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+        std::set<long long> unique;
+        for (const auto& ids : allocated)
+        {
+            CHECK(std::is_sorted(ids.begin(), ids.end()));
+            unique.insert(ids.begin(), ids.end());
+        }
+        CHECK(unique.size() == 4000);
+        last = *unique.rbegin();
+    }
+
+    // IDs of books deleted before a restart are not handed out again
+    BookIdAllocator restarted(seqFile);
+    restarted.initialize([]() { return 0LL; });
+    CHECK(restarted.next() > last);
+
+    BookIdAllocator nearEnd((dir / "near-end.seq").string());
+    nearEnd.initialize([]() { return BookIdAllocator::MAX_ID - 3; });
+    CHECK(nearEnd.next() == BookIdAllocator::MAX_ID - 2);
+    CHECK_THROWS_AS(nearEnd.reserve(5), std::overflow_error);
+    CHECK(nearEnd.next() == BookIdAllocator::MAX_ID - 1);
+    CHECK_THROWS_AS(nearEnd.next(), std::overflow_error);
+
+    long long id;
+    CHECK(BookIdAllocator::parseId(std::to_string(BookIdAllocator::MAX_ID), id));
+    CHECK(!BookIdAllocator::parseId("9223372036854775807", id));
+    CHECK(!BookIdAllocator::parseId("-1", id));
+    std::filesystem::remove_all(dir);
+}
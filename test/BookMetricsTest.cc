@@ -0,0 +1,83 @@
+#include <drogon/drogon_test.h>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+#include "controllers/BookMetrics.h"
+
+DROGON_TEST(MetricsBucketLayout)
+{
+    // Each value lands in the one bucket whose range holds it, and buckets
+    // above the exact ones span at most 1/8 of their lower bound
+    std::mt19937_64 random(3);
+    std::vector<uint64_t> values;
+    for (uint64_t v = 0; v < 4096; ++v)
+    {
+        values.push_back(v);
+    }
+    for (int exponent = 3; exponent <= BookMetrics::MAX_EXPONENT; ++exponent)
+    {
+        uint64_t power = uint64_t(1) << exponent;
+        values.insert(values.end(), {power - 1, power, power + 1, 2 * power - 1});
+    }
+    for (int i = 0; i < 10000; ++i)
+    {
+        values.push_back(random() >> (64 - 1 - BookMetrics::MAX_EXPONENT));
+    }
+
+    size_t misplaced = 0;
+    size_t tooWide = 0;
+    for (uint64_t value : values)
+    {
+        int index = BookMetrics::bucketIndex(value);
+        uint64_t lower = index == 0 ? 0 : BookMetrics::bucketUpperBound(index - 1);
+        uint64_t upper = BookMetrics::bucketUpperBound(index);
+        if (index < 0 || index >= BookMetrics::BUCKET_COUNT || value < lower || value >= upper)
+        {
+            ++misplaced;
+        }
+        if (index >= BookMetrics::SUB_BUCKETS && (upper - lower) * BookMetrics::SUB_BUCKETS > lower)
+        {
+            ++tooWide;
+        }
+    }
+    CHECK(misplaced == 0);
+    CHECK(tooWide == 0);
+
+    // Anything past the last bucket is clamped into it
+    CHECK(BookMetrics::bucketIndex(UINT64_MAX) == BookMetrics::BUCKET_COUNT - 1);
+    CHECK(BookMetrics::bucketUpperBound(BookMetrics::BUCKET_COUNT - 1) ==
+          uint64_t(1) << (BookMetrics::MAX_EXPONENT + 1));
+}
+
+DROGON_TEST(MetricsPrometheusOutput)
+{
+    BookMetrics::observe(BookMetrics::SearchBooks, BookMetrics::Total, 1500000);
+    BookMetrics::observe(BookMetrics::SearchBooks, BookMetrics::Total, 3000000001);
+    BookMetrics::addRows(BookMetrics::SearchBooks, 120, 20);
+    BookMetrics::addRejected(BookMetrics::AddBooks);
+    BookMetrics::addCoalesced(BookMetrics::GetBooks);
+    BookMetrics::setCatalogSize(11127);
+    std::string text = BookMetrics::renderPrometheus();
+    auto has = [&text](const std::string& line) { return text.find(line + "\n") != std::string::npos; };
+
+    std::string series = "{route=\"searchBooks\",phase=\"total\"";
+    CHECK(has("bookdb_request_duration_seconds_bucket" + series + ",le=\"0.001\"} 0"));
+    CHECK(has("bookdb_request_duration_seconds_bucket" + series + ",le=\"0.0025\"} 1"));
+    CHECK(has("bookdb_request_duration_seconds_bucket" + series + ",le=\"2.5\"} 1"));
+    CHECK(has("bookdb_request_duration_seconds_bucket" + series + ",le=\"5\"} 2"));
+    CHECK(has("bookdb_request_duration_seconds_bucket" + series + ",le=\"+Inf\"} 2"));
+
+    // Sums keep every nanosecond rather than the stream's six digits
+    CHECK(has("bookdb_request_duration_seconds_sum" + series + "} 3.001500001"));
+    CHECK(has("bookdb_request_duration_seconds_count" + series + "} 2"));
+
+    // Series without observations are left out
+    CHECK(text.find("route=\"deleteBook\",phase=\"total\"") == std::string::npos);
+
+    CHECK(has("bookdb_rows_scanned_total{route=\"searchBooks\"} 120"));
+    CHECK(has("bookdb_rows_returned_total{route=\"searchBooks\"} 20"));
+    CHECK(has("bookdb_requests_rejected_total{route=\"addBooks\"} 1"));
+    CHECK(has("bookdb_requests_coalesced_total{route=\"getBooks\"} 1"));
+    CHECK(has("bookdb_catalog_books 11127"));
+}
@@ -0,0 +1,240 @@
+#include <drogon/drogon_test.h>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "TestSupport.h"
+
+DROGON_TEST(MutationLogTornTail)
+{
+    auto dir = scratchDir("torn-tail");
+    std::string dataFile = (dir / "shard.csv").string();
+    std::string logFile = (dir / "shard.log").string();
+    ShardOptions options;
+    {
+        BookShard shard(dataFile, logFile, options);
+        shard.load();
+        shard.open();
+        commitAndWait([&](CommitCallback done) { shard.put({makeBook(1, "First")}, std::move(done)); });
+        commitAndWait([&](CommitCallback done) { shard.put({makeBook(2, "Second")}, std::move(done)); });
+    }
+
+    // A crash in the middle of a write leaves a record without its newline
+    {
+        std::ofstream log(logFile, std::ios::app | std::ios::binary);
+        log << "P,3,Torn";
+    }
+
+    {
+        BookShard shard(dataFile, logFile, options);
+        shard.load();
+        CHECK(shard.size() == 2);
+        REQUIRE(shard.find(2) != nullptr);
+        CHECK(shard.find(2)->title == "Second");
+        CHECK(shard.find(3) == nullptr);
+
+        // Records written after recovery must not run into the torn one
+        shard.open();
+        commitAndWait([&](CommitCallback done) { shard.put({makeBook(4, "Fourth")}, std::move(done)); });
+    }
+
+    BookShard shard(dataFile, logFile, options);
+    shard.load();
+    CHECK(shard.size() == 3);
+    CHECK(shard.find(3) == nullptr);
+    REQUIRE(shard.find(4) != nullptr);
+    CHECK(shard.find(4)->title == "Fourth");
+    std::filesystem::remove_all(dir);
+}
+
+DROGON_TEST(ShardCompactionReload)
+{
+    auto dir = scratchDir("compaction");
+    std::string dataFile = (dir / "shard.csv").string();
+    std::string logFile = (dir / "shard.log").string();
+    ShardOptions options;
+    options.compactionRecords = 4;
+    {
+        BookShard shard(dataFile, logFile, options);
+        shard.load();
+        shard.open();
+        for (long long id = 1; id <= 10; ++id)
+        {
+            commitAndWait([&](CommitCallback done) {
+                shard.put({makeBook(id, "Book " + std::to_string(id))}, std::move(done));
+            });
+        }
+        commitAndWait([&](CommitCallback done) {
+            CHECK(shard.update(3, [](Book& book) { book.title = "He said \"three\", twice"; }, std::move(done)));
+        });
+        commitAndWait([&](CommitCallback done) { CHECK(shard.remove(5, std::move(done))); });
+    }
+
+    // Everything up to the last compaction lives in the snapshot
+    CHECK(countLines(logFile) < options.compactionRecords);
+
+    BookShard shard(dataFile, logFile, options);
+    shard.load();
+    CHECK(shard.size() == 9);
+    REQUIRE(shard.find(3) != nullptr);
+    CHECK(shard.find(3)->title == "He said \"three\", twice");
+    CHECK(shard.find(5) == nullptr);
+    REQUIRE(shard.find(10) != nullptr);
+    CHECK(shard.find(10)->title == "Book 10");
+    std::filesystem::remove_all(dir);
+}
+
+DROGON_TEST(ShardManifestRecovery)
+{
+    auto dir = scratchDir("manifest");
+    auto manifest = dir / "books.shards";
+    writeSeed(dir, {"1,Seeded,Seed Author,4.00,,,eng,100,10,1,1/1/2000,Seed Press"});
+    {
+        BookStore store;
+        store.initAndStart(storeConfig(dir, 2));
+        CHECK(store.size() == 1);
+        commitAndWait([&](CommitCallback done) { store.insertBatch({*makeBook(0, "Added")}, std::move(done)); });
+        commitAndWait([&](CommitCallback done) { CHECK(store.remove(1, std::move(done))); });
+        store.shutdown();
+    }
+
+    // A manifest lost or emptied by a crash is recovered from the shard files;
+    // re-importing the seed would bring book 1 back and drop the added one
+    for (bool empty : {false, true})
+    {
+        std::filesystem::remove(manifest);
+        if (empty)
+        {
+            std::ofstream(manifest).flush();
+        }
+        BookStore store;
+        store.initAndStart(storeConfig(dir, 2));
+        CHECK(store.size() == 1);
+        CHECK(store.find(1) == nullptr);
+        CHECK(countLines(manifest.string()) == 1);
+        store.shutdown();
+    }
+
+    // Re-partitioning records the new layout before removing the old one
+    {
+        BookStore store;
+        store.initAndStart(storeConfig(dir, 3));
+        CHECK(store.size() == 1);
+        store.shutdown();
+    }
+    CHECK(!std::filesystem::exists(dir / "books-2.0.csv"));
+    std::ifstream recorded(manifest);
+    size_t shards = 0;
+    recorded >> shards;
+    CHECK(shards == 3);
+
+    // Two complete layouts and no manifest: which one is current is unknown
+    std::filesystem::remove(manifest);
+    std::ofstream(dir / "books-1.0.csv").flush();
+    BookStore ambiguous;
+    CHECK_THROWS_AS(ambiguous.initAndStart(storeConfig(dir, 3)), StorageError);
+    std::filesystem::remove_all(dir);
+}
+
+DROGON_TEST(BookCsvRoundTrip)
+{
+    Book book;
+    book.bookID = "7";
+    book.title = " Leading and trailing ";
+    book.authors = "Smith, \"J.\"";
+    book.avgRating = "4.00";
+    book.isbn = "  ";
+    book.publisher = "Press ";
+    Book parsed = Book::fromCSV(book.toCSV());
+    CHECK(parsed.bookID == book.bookID);
+    CHECK(parsed.title == book.title);
+    CHECK(parsed.authors == book.authors);
+    CHECK(parsed.avgRating == book.avgRating);
+    CHECK(parsed.isbn == book.isbn);
+    CHECK(parsed.isbn13.empty());
+    CHECK(parsed.publisher == book.publisher);
+    CHECK(Book::escapeCSV("plain") == "plain");
+}
+
+DROGON_TEST(RejectedUpsertKeepsSequence)
+{
+    auto dir = scratchDir("rejected-upsert");
+    writeSeed(dir, {"1,Seeded,Seed Author,4.00,,,eng,100,10,1,1/1/2000,Seed Press"});
+    BookStore store;
+    store.initAndStart(storeConfig(dir, 2));
+
+    // A patch that fails validation must not claim its ID
+    CHECK_THROWS_AS(store.upsert(
+                        5000, [](Book&) { throw std::invalid_argument("Invalid avgRating"); }, [](std::exception_ptr) {}),
+                    std::invalid_argument);
+    CHECK(store.find(5000) == nullptr);
+    BookPtr added;
+    commitAndWait([&](CommitCallback done) { added = store.insert(*makeBook(0, "Next"), std::move(done)); });
+    CHECK(added->bookID == "2");
+    store.shutdown();
+    std::filesystem::remove_all(dir);
+}
+
+DROGON_TEST(PartialBatchNamesStoredIds)
+{
+    auto dir = scratchDir("partial-batch");
+    writeSeed(dir, {});
+    BookStore store;
+    store.initAndStart(storeConfig(dir, 2));
+
+    // Only the shard holding the oversized book fails its commit
+    std::vector<Book> books;
+    books.push_back(*makeBook(0, std::string(8192, 'x')));
+    for (int i = 0; i < 7; ++i)
+    {
+        books.push_back(*makeBook(0, "Small"));
+    }
+    std::string message;
+    std::vector<BookPtr> stored;
+    {
+        FileSizeLimit limit(4096);
+        try
+        {
+            commitAndWait([&](CommitCallback done) { stored = store.insertBatch(books, std::move(done)); });
+        }
+        catch (const StorageError& e)
+        {
+            message = e.what();
+        }
+    }
+    REQUIRE(stored.size() == books.size());
+    std::string marker = "only the books with these IDs were stored: ";
+    auto listed = message.find(marker);
+    REQUIRE(listed != std::string::npos);
+
+    // The message names exactly the books that exist, as runs like "3-5,9"
+    std::set<long long> named;
+    std::istringstream ranges(message.substr(listed + marker.size()));
+    std::string range;
+    while (std::getline(ranges, range, ','))
+    {
+        long long first = std::stoll(range);
+        auto dash = range.find('-');
+        long long last = dash == std::string::npos ? first : std::stoll(range.substr(dash + 1));
+        for (long long id = first; id <= last; ++id)
+        {
+            named.insert(id);
+        }
+    }
+    size_t kept = 0;
+    for (const auto& book : stored)
+    {
+        long long id = std::stoll(book->bookID);
+        bool present = store.find(id) != nullptr;
+        CHECK(named.count(id) == (present ? 1u : 0u));
+        kept += present;
+    }
+    CHECK(named.size() == kept);
+    CHECK(kept > 0);
+    CHECK(kept < stored.size());
+    store.shutdown();
+    std::filesystem::remove_all(dir);
+}
@@ -0,0 +1,125 @@
+#include <drogon/drogon_test.h>
+#include <chrono>
+#include <filesystem>
+#include <future>
+#include <string>
+#include <vector>
+#include "TestSupport.h"
+
+namespace
+{
+// Queue a put without waiting for it
+std::future<std::exception_ptr> startPut(BookShard& shard, BookPtr book)
+{
+    auto committed = std::make_shared<std::promise<std::exception_ptr>>();
+    auto result = committed->get_future();
+    shard.put({std::move(book)}, [committed](std::exception_ptr error) { committed->set_value(error); });
+    return result;
+}
+}  // namespace
+
+DROGON_TEST(GroupCommitWindow)
+{
+    auto dir = scratchDir("commit-window");
+    ShardOptions options;
+    options.commitWindow = std::chrono::milliseconds(200);
+    options.commitMaxBatch = 4;
+    BookShard shard((dir / "shard.csv").string(), (dir / "shard.log").string(), options);
+    shard.load();
+    shard.open();
+
+    // A lone mutation waits out the window for others to join it
+    auto start = std::chrono::steady_clock::now();
+    commitAndWait([&](CommitCallback done) { shard.put({makeBook(1, "Alone")}, std::move(done)); });
+    CHECK(std::chrono::steady_clock::now() - start >= options.commitWindow);
+
+    // A full batch is written without waiting
+    ShardOptions batchOptions = options;
+    batchOptions.commitWindow = std::chrono::seconds(30);
+    BookShard batched((dir / "batched.csv").string(), (dir / "batched.log").string(), batchOptions);
+    batched.load();
+    batched.open();
+    start = std::chrono::steady_clock::now();
+    std::vector<std::future<std::exception_ptr>> puts;
+    for (long long id = 1; id <= 4; ++id)
+    {
+        puts.push_back(startPut(batched, makeBook(id, "Batched")));
+    }
+    for (auto& put : puts)
+    {
+        CHECK(put.get() == nullptr);
+    }
+    CHECK(std::chrono::steady_clock::now() - start < batchOptions.commitWindow);
+    CHECK(countLines((dir / "batched.log").string()) == 4);
+    std::filesystem::remove_all(dir);
+}
+
+DROGON_TEST(GroupCommitRollBack)
+{
+    auto dir = scratchDir("commit-rollback");
+    std::string dataFile = (dir / "shard.csv").string();
+    std::string logFile = (dir / "shard.log").string();
+    ShardOptions options;
+    options.compactionRecords = 2;
+    {
+        BookShard shard(dataFile, logFile, options);
+        shard.load();
+        shard.open();
+        commitAndWait([&](CommitCallback done) { shard.put({makeBook(1, "Kept")}, std::move(done)); });
+
+        // The write fails part way, leaving a torn record for the rollback to cut
+        {
+            FileSizeLimit limit(std::filesystem::file_size(logFile) + 16);
+            CHECK_THROWS_AS(commitAndWait([&](CommitCallback done) {
+                                shard.put({makeBook(2, std::string(100, 'x'))}, std::move(done));
+                            }),
+                            StorageError);
+        }
+        CHECK(shard.find(2) == nullptr);
+        CHECK(shard.size() == 1);
+
+        // The shard keeps taking writes, and the next one triggers a compaction
+        commitAndWait([&](CommitCallback done) { shard.put({makeBook(3, "After")}, std::move(done)); });
+    }
+    CHECK(countLines(logFile) == 0);
+
+    BookShard shard(dataFile, logFile, options);
+    shard.load();
+    CHECK(shard.size() == 2);
+    CHECK(shard.find(1) != nullptr);
+    CHECK(shard.find(2) == nullptr);
+    CHECK(shard.find(3) != nullptr);
+    std::filesystem::remove_all(dir);
+}
+
+DROGON_TEST(GroupCommitReadOnlyAfterFailedRollBack)
+{
+    auto dir = scratchDir("commit-read-only");
+    std::string dataFile = (dir / "shard.csv").string();
+    std::string logFile = (dir / "shard.log").string();
+    ShardOptions options;
+    BookShard shard(dataFile, logFile, options);
+    shard.load();
+    shard.open();
+    commitAndWait([&](CommitCallback done) { shard.put({makeBook(1, "Kept")}, std::move(done)); });
+
+    // An unreadable snapshot makes the reload after the failed commit fail too
+    std::filesystem::remove(dataFile);
+    std::filesystem::create_directory(dataFile);
+    {
+        FileSizeLimit limit(std::filesystem::file_size(logFile));
+        CHECK_THROWS_AS(commitAndWait([&](CommitCallback done) {
+                            shard.put({makeBook(2, "Lost")}, std::move(done));
+                        }),
+                        StorageError);
+    }
+
+    // Writes are refused before they touch memory
+    CHECK_THROWS_AS(commitAndWait([&](CommitCallback done) { shard.put({makeBook(3, "Refused")}, std::move(done)); }),
+                    StorageError);
+    CHECK(shard.find(3) == nullptr);
+    CHECK_THROWS_AS(commitAndWait([&](CommitCallback done) { shard.remove(1, std::move(done)); }), StorageError);
+    CHECK(shard.find(1) != nullptr);
+    shard.close();
+    std::filesystem::remove_all(dir);
+}
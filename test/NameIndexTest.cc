@@ -0,0 +1,70 @@
+#include <drogon/drogon_test.h>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "TestSupport.h"
+
+DROGON_TEST(AuthorNamesSplitting)
+{
+    Book book;
+    book.authors = " J.K. Rowling / Mary  GrandPré/j.k.  rowling//";
+    CHECK(book.authorNames() == std::vector<std::string>({"J.K. Rowling", "Mary GrandPré"}));
+    book.authors = "";
+    CHECK(book.authorNames().empty());
+    CHECK(BookStore::normalizeName("  Alan   LEE ") == "alan lee");
+}
+
+DROGON_TEST(NameIndexMergesShards)
+{
+    // Enough books that every name's postings are spread over all the shards
+    auto dir = scratchDir("name-index");
+    std::vector<std::string> rows;
+    for (int id = 1; id <= 40; ++id)
+    {
+        std::string authors = id % 2 ? "Alan Lee/J.R.R. Tolkien" : "alan  lee";
+        std::string publisher = id % 3 ? "Allen & Unwin" : "Houghton Mifflin";
+        rows.push_back(std::to_string(id) + ",Book " + std::to_string(id) + "," + authors + ",4.00,,,eng,100,10,1,1/1/2000," +
+                       publisher);
+    }
+    writeSeed(dir, rows);
+    BookStore store;
+    store.initAndStart(storeConfig(dir, 4));
+
+    // Postings from every shard come back as one list in bookID order
+    auto books = store.booksByAuthor("ALAN LEE", -1, 0);
+    REQUIRE(books.size() == 40);
+    for (size_t i = 0; i < books.size(); ++i)
+    {
+        CHECK(books[i]->bookID == std::to_string(i + 1));
+    }
+    auto page = store.booksByAuthor("alan lee", 5, 12);
+    REQUIRE(page.size() == 5);
+    CHECK(page.front()->bookID == "13");
+    CHECK(page.back()->bookID == "17");
+    CHECK(store.booksByAuthor("alan lee", 10, 40).empty());
+    CHECK(store.booksByAuthor("Nobody", -1, 0).empty());
+    CHECK(store.booksByPublisher("houghton mifflin", -1, 0).size() == 13);
+
+    // A name held by several shards is listed once, with the counts summed
+    auto authors = store.authors(-1, 0);
+    REQUIRE(authors.size() == 2);
+    CHECK(BookStore::normalizeName(authors[0].name) == "alan lee");
+    CHECK(authors[0].bookCount == 40);
+    CHECK(authors[1].name == "J.R.R. Tolkien");
+    CHECK(authors[1].bookCount == 20);
+    auto secondAuthor = store.authors(1, 1);
+    REQUIRE(secondAuthor.size() == 1);
+    CHECK(secondAuthor[0].name == "J.R.R. Tolkien");
+    auto publishers = store.publishers(-1, 0);
+    REQUIRE(publishers.size() == 2);
+    CHECK(publishers[0].name == "Allen & Unwin");
+    CHECK(publishers[0].bookCount == 27);
+    CHECK(publishers[1].bookCount == 13);
+
+    // Postings follow deletes across shards
+    commitAndWait([&](CommitCallback done) { CHECK(store.remove(13, std::move(done))); });
+    CHECK(store.booksByAuthor("alan lee", 1, 12).front()->bookID == "14");
+    CHECK(store.authors(1, 0).front().bookCount == 39);
+    store.shutdown();
+    std::filesystem::remove_all(dir);
+}
@@ -0,0 +1,81 @@
+#include <drogon/drogon_test.h>
+#include <drogon/drogon.h>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include "controllers/RequestCoalescer.h"
+
+namespace
+{
+// Follow a flight the way a handler does, recording what it yields
+drogon::AsyncTask follow(std::shared_ptr<RequestCoalescer::Flight> flight, drogon::HttpResponsePtr& response,
+                         std::exception_ptr& error)
+{
+    try
+    {
+        response = co_await RequestCoalescer::wait(std::move(flight));
+    }
+    catch (...)
+    {
+        error = std::current_exception();
+    }
+}
+}  // namespace
+
+DROGON_TEST(RequestCoalescerSharesResponse)
+{
+    RequestCoalescer coalescer;
+    auto key = RequestCoalescer::key({"books", "20", "0"});
+    bool leader;
+    auto flight = coalescer.join(key, leader);
+    CHECK(leader);
+
+    bool followerLeads;
+    auto early = coalescer.join(key, followerLeads);
+    CHECK(!followerLeads);
+    CHECK(early == flight);
+    auto late = coalescer.join(key, followerLeads);
+    CHECK(!followerLeads);
+
+    // One follower is suspended before the leader finishes, the other awaits after
+    drogon::HttpResponsePtr waited;
+    std::exception_ptr error;
+    follow(early, waited, error);
+    CHECK(!waited);
+
+    auto resp = drogon::HttpResponse::newHttpResponse();
+    resp->setContentTypeCode(drogon::CT_APPLICATION_JSON);
+    resp->addHeader("X-Catalog-Version", "7");
+    resp->setBody("[1,2,3]");
+    coalescer.finish(key, flight, resp);
+
+    REQUIRE(waited != nullptr);
+    CHECK(!error);
+    CHECK(waited != resp);
+    CHECK(waited->body() == "[1,2,3]");
+    CHECK(waited->contentType() == drogon::CT_APPLICATION_JSON);
+    CHECK(waited->getHeader("X-Catalog-Version") == "7");
+
+    // Every follower gets the same clone rather than a copy of its own
+    drogon::HttpResponsePtr after;
+    follow(late, after, error);
+    CHECK(after == waited);
+
+    // The finished flight is retired; the next request leads a new one
+    auto next = coalescer.join(key, leader);
+    CHECK(leader);
+    CHECK(next != flight);
+
+    // The leader's error reaches its followers
+    auto failing = coalescer.join(key, followerLeads);
+    drogon::HttpResponsePtr none;
+    std::exception_ptr failed;
+    follow(failing, none, failed);
+    coalescer.finish(key, next, nullptr, std::make_exception_ptr(std::invalid_argument("Bad filter")));
+    CHECK(!none);
+    REQUIRE(failed != nullptr);
+    CHECK_THROWS_AS(std::rethrow_exception(failed), std::invalid_argument);
+
+    // Parameters cannot imitate the separator between them
+    CHECK(RequestCoalescer::key({"a:b", "c"}) != RequestCoalescer::key({"a", "b:c"}));
+}
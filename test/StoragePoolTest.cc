@@ -0,0 +1,89 @@
+#include <drogon/drogon_test.h>
+#include <drogon/drogon.h>
+#include <exception>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include "plugins/StoragePool.h"
+
+namespace
+{
+// Await pool work the way a handler does, reporting the outcome through a promise
+drogon::AsyncTask awaitRun(BoundedPool& pool, std::promise<int>& outcome)
+{
+    try
+    {
+        outcome.set_value(co_await pool.run([]() { return 42; }));
+    }
+    catch (...)
+    {
+        outcome.set_exception(std::current_exception());
+    }
+}
+
+drogon::AsyncTask awaitCommitted(BoundedPool& pool, std::exception_ptr commitError, std::promise<std::string>& outcome)
+{
+    try
+    {
+        outcome.set_value(co_await pool.runCommitted([commitError](BoundedPool::CommitCallback done) {
+            // The store fires the callback later, from its committer thread
+            std::thread([done, commitError]() { done(commitError); }).detach();
+            return std::string("stored");
+        }));
+    }
+    catch (...)
+    {
+        outcome.set_exception(std::current_exception());
+    }
+}
+}  // namespace
+
+DROGON_TEST(BoundedPoolRejectsWhenFull)
+{
+    BoundedPool pool("test", 1, 1);
+
+    // Hold the only worker so that queued work stays queued
+    std::promise<void> release;
+    auto released = release.get_future().share();
+    std::promise<void> started;
+    CHECK(pool.submit([released, &started]() {
+        started.set_value();
+        released.wait();
+    }));
+    started.get_future().wait();
+    std::promise<void> drained;
+    CHECK(pool.submit([&drained]() { drained.set_value(); }));
+    CHECK(pool.queued() == 1);
+    CHECK(!pool.submit([]() {}));
+
+    // An await on the full pool fails at once instead of queueing; handlers
+    // turn this into 503 Service Unavailable
+    std::promise<int> rejected;
+    auto rejectedResult = rejected.get_future();
+    awaitRun(pool, rejected);
+    CHECK_THROWS_AS(rejectedResult.get(), PoolOverloaded);
+
+    // Once the queue has drained, work is accepted again
+    release.set_value();
+    drained.get_future().wait();
+    std::promise<int> accepted;
+    auto acceptedResult = accepted.get_future();
+    awaitRun(pool, accepted);
+    CHECK(acceptedResult.get() == 42);
+}
+
+DROGON_TEST(BoundedPoolWaitsForCommit)
+{
+    BoundedPool pool("test", 2, 4);
+    std::promise<std::string> stored;
+    auto storedResult = stored.get_future();
+    awaitCommitted(pool, nullptr, stored);
+    CHECK(storedResult.get() == "stored");
+
+    // A failed commit is rethrown even though the work itself returned
+    std::promise<std::string> failed;
+    auto failedResult = failed.get_future();
+    awaitCommitted(pool, std::make_exception_ptr(std::runtime_error("sync failed")), failed);
+    CHECK_THROWS_AS(failedResult.get(), std::runtime_error);
+}
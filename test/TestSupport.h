@@ -0,0 +1,97 @@
+#pragma once
+#include <algorithm>
+#include <csignal>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+#include "plugins/BookStore.h"
+
+// Helpers shared by the storage tests
+
+// An empty scratch directory for one test
+inline std::filesystem::path scratchDir(const std::string& name)
+{
+    auto dir = std::filesystem::temp_directory_path() / ("bookdb-test-" + name);
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    return dir;
+}
+
+inline BookPtr makeBook(long long id, const std::string& title)
+{
+    auto book = std::make_shared<Book>();
+    book->bookID = std::to_string(id);
+    book->title = title;
+    book->authors = "Test Author";
+    book->publisher = "Test Press";
+    return book;
+}
+
+// Run a shard mutation and wait until it is durable
+inline void commitAndWait(const std::function<void(CommitCallback)>& mutate)
+{
+    std::promise<std::exception_ptr> committed;
+    auto result = committed.get_future();
+    mutate([&committed](std::exception_ptr error) { committed.set_value(error); });
+    if (auto error = result.get())
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+inline size_t countLines(const std::string& path)
+{
+    std::ifstream file(path);
+    return std::count(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>(), '\n');
+}
+
+// Write a seed catalog of CSV rows, below the header, into dir
+inline void writeSeed(const std::filesystem::path& dir, const std::vector<std::string>& rows)
+{
+    std::ofstream seed(dir / "books.csv", std::ios::trunc);
+    seed << "bookID,title,authors,average_rating,isbn,isbn13,language_code,num_pages,ratings_count,"
+            "text_reviews_count,publication_date,publisher\n";
+    for (const auto& row : rows)
+    {
+        seed << row << "\n";
+    }
+}
+
+// BookStore settings for a store kept in dir
+inline Json::Value storeConfig(const std::filesystem::path& dir, size_t shards)
+{
+    Json::Value config;
+    config["data_dir"] = dir.string();
+    config["shards"] = static_cast<Json::UInt>(shards);
+    return config;
+}
+
+// Fails writes that would grow any file past limit bytes, until destroyed
+class FileSizeLimit
+{
+public:
+    explicit FileSizeLimit(rlim_t limit)
+    {
+        previousHandler_ = std::signal(SIGXFSZ, SIG_IGN);
+        ::getrlimit(RLIMIT_FSIZE, &previous_);
+        rlimit capped = previous_;
+        capped.rlim_cur = limit;
+        ::setrlimit(RLIMIT_FSIZE, &capped);
+    }
+
+    ~FileSizeLimit()
+    {
+        ::setrlimit(RLIMIT_FSIZE, &previous_);
+        std::signal(SIGXFSZ, previousHandler_);
+    }
+
+private:
+    rlimit previous_;
+    void (*previousHandler_)(int);
+};
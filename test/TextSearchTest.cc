@@ -0,0 +1,120 @@
+#include <drogon/drogon_test.h>
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "plugins/TextSearch.h"
+
+namespace
+{
+// Fewest optimal-string-alignment edits turning pattern into any substring of text
+size_t bruteForceDistance(const std::string& pattern, const std::string& text)
+{
+    size_t m = pattern.size();
+    std::vector<std::vector<size_t>> d(text.size() + 1, std::vector<size_t>(m + 1));
+    for (size_t i = 0; i <= m; ++i)
+    {
+        d[0][i] = i;
+    }
+    size_t best = m;
+    for (size_t j = 1; j <= text.size(); ++j)
+    {
+        d[j][0] = 0;
+        for (size_t i = 1; i <= m; ++i)
+        {
+            size_t cost = pattern[i - 1] == text[j - 1] ? 0 : 1;
+            d[j][i] = std::min({d[j - 1][i] + 1, d[j][i - 1] + 1, d[j - 1][i - 1] + cost});
+            if (i > 1 && j > 1 && pattern[i - 1] == text[j - 2] && pattern[i - 2] == text[j - 1])
+            {
+                d[j][i] = std::min(d[j][i], d[j - 2][i - 2] + 1);
+            }
+        }
+        best = std::min(best, d[j][m]);
+    }
+    return best;
+}
+
+std::string randomText(std::mt19937& random, size_t size, const std::string& alphabet)
+{
+    std::string text(size, ' ');
+    for (auto& c : text)
+    {
+        c = alphabet[random() % alphabet.size()];
+    }
+    return text;
+}
+}  // namespace
+
+DROGON_TEST(MyersMatcherMatchesBruteForce)
+{
+    // Small alphabets make matches, near misses and transpositions common
+    std::mt19937 random(1);
+    size_t mismatches = 0;
+    for (int run = 0; run < 5000; ++run)
+    {
+        std::string pattern = randomText(random, 1 + random() % MyersMatcher::MAX_PATTERN, "abcd");
+        std::string text = randomText(random, random() % 80, "abcd");
+        if (MyersMatcher(pattern).distance(text) != bruteForceDistance(pattern, text))
+        {
+            ++mismatches;
+        }
+    }
+    CHECK(mismatches == 0);
+
+    CHECK(MyersMatcher("tolkein").distance("the hobbit j r r tolkien") == 1);
+    CHECK(MyersMatcher("hobbit").distance("the hobbit j r r tolkien") == 0);
+    CHECK_THROWS_AS(MyersMatcher(std::string(MyersMatcher::MAX_PATTERN + 1, 'a')), std::invalid_argument);
+}
+
+DROGON_TEST(TrigramCandidatesKeepEveryMatch)
+{
+    // Every text within k edits of the pattern must survive the |T| - 4k bound
+    std::mt19937 random(2);
+    std::vector<std::string> texts;
+    TrigramIndex index;
+    for (long long id = 0; id < 300; ++id)
+    {
+        texts.push_back(randomText(random, 5 + random() % 40, "abc "));
+        index.add(id, texts.back());
+    }
+    size_t missed = 0;
+    size_t pruned = 0;
+    for (int run = 0; run < 500; ++run)
+    {
+        // Patterns are mutated substrings so that near matches are common
+        const auto& source = texts[random() % texts.size()];
+        size_t start = random() % source.size();
+        std::string pattern = source.substr(start, 4 + random() % 16);
+        for (size_t edit = random() % 3; edit > 0 && pattern.size() > 1; --edit)
+        {
+            size_t pos = random() % (pattern.size() - 1);
+            std::swap(pattern[pos], pattern[pos + 1]);
+        }
+        size_t maxEdits = random() % 3;
+        auto grams = TrigramIndex::trigrams(pattern);
+        if (grams.size() <= 4 * maxEdits)
+        {
+            continue;
+        }
+        auto ids = index.candidates(grams, grams.size() - 4 * maxEdits);
+        std::sort(ids.begin(), ids.end());
+        pruned += texts.size() - ids.size();
+        for (long long id = 0; id < static_cast<long long>(texts.size()); ++id)
+        {
+            if (bruteForceDistance(pattern, texts[id]) <= maxEdits && !std::binary_search(ids.begin(), ids.end(), id))
+            {
+                ++missed;
+            }
+        }
+    }
+    CHECK(missed == 0);
+    CHECK(pruned > 0);
+
+    // Typos at the start of a word still reach their book
+    index.clear();
+    index.add(1, TrigramIndex::normalize("The Great Gatsby F. Scott Fitzgerald"));
+    index.add(2, TrigramIndex::normalize("Pride and Prejudice Jane Austen"));
+    auto grams = TrigramIndex::trigrams("teh great gatsby");
+    CHECK(index.candidates(grams, grams.size() - 8) == std::vector<long long>{1});
+}
@@ -1,11 +1,8 @@
 #define DROGON_TEST_MAIN
 #include <drogon/drogon_test.h>
 #include <drogon/drogon.h>
-
-DROGON_TEST(BasicTest)
-{
-    // Add your tests here
-}
+#include <future>
+#include <thread>
 
 int main(int argc, char** argv) 
 {